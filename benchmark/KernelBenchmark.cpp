@@ -0,0 +1,450 @@
+//Times the hot functions of the detection and solve pipeline in isolation
+//Runs on a synthetic table scene by default, or on a recorded frame and its calibration
+//Prints the latency percentiles of every kernel as json, see LatencyStats
+
+#include <iostream>
+#include <fstream>
+#include <array>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <filesystem>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/objdetect/aruco_detector.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <Misc/path.hpp>
+#include <Misc/math3d.hpp>
+#include <Misc/GlobalConf.hpp>
+#include <Misc/LatencyStats.hpp>
+#include <Cameras/Camera.hpp>
+#include <Cameras/Calibfile.hpp>
+#include <Cameras/ImageTypes.hpp>
+#include <DetectFeatures/ArucoDetect.hpp>
+#include <DetectFeatures/ArucoGridTuner.hpp>
+#include <ArucoPipeline/StaticObject.hpp>
+#include <ArucoPipeline/TopTracker.hpp>
+#include <Communication/JsonListener.hpp>
+
+using namespace std;
+using namespace cv;
+
+//Camera fed with a fixed frame, so that Undistort can run without a device
+class FixtureCamera : public Camera
+{
+private:
+	UMat Frame;
+
+protected:
+	virtual bool ApplyControl(CameraControl Control, int Value) override
+	{
+		(void)Control;
+		(void)Value;
+		return true;
+	}
+
+public:
+	FixtureCamera(shared_ptr<VideoCaptureCameraSettings> InSettings, UMat InFrame)
+		:Camera(InSettings), Frame(InFrame)
+	{
+	}
+
+	virtual bool StartFeed() override
+	{
+		Name = "Fixture";
+		connected = true;
+		return true;
+	}
+
+	virtual bool Read() override
+	{
+		if (!connected)
+		{
+			return false;
+		}
+		LastFrameDistorted = Frame;
+		Camera::Read();
+		return true;
+	}
+};
+
+struct Fixture
+{
+	LensSettings Lens;
+	Size Resolution;
+	Affine3d WorldToCamera;
+	CameraImageData ImageData;
+	//Tag corners as a detection would give them
+	CameraFeatureData Features;
+	//Same tags seen by two lenses of a side by side camera
+	CameraFeatureData StereoFeatures;
+	StaticObject Board;
+	vector<shared_ptr<TopTracker>> Tops;
+
+	Fixture()
+		:Board(false, "Board")
+	{
+	}
+};
+
+static Affine3d LookAt(Vec3d Position, Vec3d Target)
+{
+	Vec3d Forward = Target - Position;
+	//camera x goes right, y down and z forward
+	Vec3d Right = Forward.cross(Vec3d(0,0,1));
+	return Affine3d(MakeRotationFromZX(Forward, Right), Position);
+}
+
+//Corners of every tag of the scene, in world space
+static void GetSceneTags(Fixture &Scene, vector<int> &IDs, vector<array<Point3d, 4>> &Corners)
+{
+	vector<TrackedObject*> Objects = {&Scene.Board};
+	for (auto &top : Scene.Tops)
+	{
+		Objects.push_back(top.get());
+	}
+	for (TrackedObject* object : Objects)
+	{
+		Affine3d ObjectLocation = object->GetLocation();
+		for (const ArucoMarker &marker : object->markers)
+		{
+			Affine3d MarkerToWorld = ObjectLocation * marker.Pose;
+			array<Point3d, 4> corners;
+			auto &local = marker.GetObjectPointsNoOffset();
+			for (size_t i = 0; i < local.size(); i++)
+			{
+				corners[i] = MarkerToWorld * local[i];
+			}
+			IDs.push_back(marker.number);
+			Corners.push_back(corners);
+		}
+	}
+}
+
+static void ProjectTags(const vector<array<Point3d, 4>> &Corners, const vector<int> &IDs, Affine3d WorldToLens,
+	const LensSettings &Lens, LensFeatureData &Out)
+{
+	Affine3d LensFromWorld = WorldToLens.inv();
+	for (size_t i = 0; i < Corners.size(); i++)
+	{
+		vector<Point3d> local(Corners[i].begin(), Corners[i].end());
+		for (auto &point : local)
+		{
+			point = LensFromWorld * point;
+		}
+		ArucoCornerArray projected;
+		projectPoints(local, Vec3d::zeros(), Vec3d::zeros(), Lens.CameraMatrix, Lens.distanceCoeffs, projected);
+		Out.ArucoCorners.push_back(projected);
+		Out.ArucoIndices.push_back(IDs[i]);
+		Out.StereoReprojected.push_back(false);
+	}
+	Out.WorldToLens = WorldToLens;
+}
+
+//Draws the tags where the lens sees them, on a noisy grey table
+static UMat RenderTags(const LensFeatureData &Projected, Size Resolution)
+{
+	auto &dictionary = GetArucoDetector().getDictionary();
+	Mat Image(Resolution, CV_8UC3);
+	RNG rng(42);
+	rng.fill(Image, RNG::NORMAL, Scalar::all(110), Scalar::all(8));
+	const int MarkerPixels = 120;
+	for (size_t i = 0; i < Projected.ArucoIndices.size(); i++)
+	{
+		Mat Marker, MarkerBGR;
+		aruco::generateImageMarker(dictionary, Projected.ArucoIndices[i], MarkerPixels, Marker, 1);
+		cvtColor(Marker, MarkerBGR, COLOR_GRAY2BGR);
+		vector<Point2f> Source = {{0,0}, {(float)MarkerPixels,0}, {(float)MarkerPixels,(float)MarkerPixels}, {0,(float)MarkerPixels}};
+		const ArucoCornerArray &Target = Projected.ArucoCorners[i];
+		//white quiet zone around the tag
+		Point2f center = (Target[0] + Target[1] + Target[2] + Target[3]) / 4;
+		vector<Point> Quiet;
+		for (auto &corner : Target)
+		{
+			Quiet.push_back(center + (corner - center) * 1.4);
+		}
+		fillConvexPoly(Image, Quiet, Scalar::all(230), LINE_AA);
+		Mat Homography = getPerspectiveTransform(Source, Target);
+		warpPerspective(MarkerBGR, Image, Homography, Resolution, INTER_LINEAR, BORDER_TRANSPARENT);
+	}
+	return Image.getUMat(ACCESS_READ).clone();
+}
+
+static void FillImageData(Fixture &Scene, UMat Image)
+{
+	Scene.ImageData.CameraName = "Fixture";
+	Scene.ImageData.Image = Image;
+	Scene.ImageData.lenses = {Scene.Lens};
+	Scene.ImageData.GrabTime = chrono::steady_clock::now();
+	Scene.ImageData.Distorted = true;
+	Scene.ImageData.Valid = true;
+}
+
+static void MakeSyntheticFixture(Fixture &Scene)
+{
+	Scene.Resolution = Size(1920, 1080);
+	Scene.Lens.ROI = Rect(Point(0,0), Scene.Resolution);
+	Scene.Lens.CameraMatrix = (Mat_<double>(3,3) << 1400, 0, 960, 0, 1400, 540, 0, 0, 1);
+	Scene.Lens.distanceCoeffs = (Mat_<double>(1,5) << -0.05, 0.01, 0, 0, 0);
+	Scene.Lens.CameraToLens = Affine3d::Identity();
+	//from a corner of the table, like the fixed cameras
+	Scene.WorldToCamera = LookAt(Vec3d(0, -1.6, 1.4), Vec3d(0, 0, 0));
+	vector<string> Names = {"Triangle", "Carre", "Rond", "Star"};
+	for (size_t i = 0; i < Names.size(); i++)
+	{
+		auto top = make_shared<TopTracker>(51+i, 0.0695, Names[i], .148, false);
+		top->SetLocation(Affine3d(MakeRotationFromZX(Vec3d(0,0,1), Vec3d(cos(i), sin(i), 0)),
+			Vec3d(-0.6 + 0.4*i, 0.2 - 0.15*i, 0.148)), TrackedObject::Clock::now());
+		Scene.Tops.push_back(top);
+	}
+
+	vector<int> IDs;
+	vector<array<Point3d, 4>> Corners;
+	GetSceneTags(Scene, IDs, Corners);
+
+	CameraImageData Empty;
+	Empty.lenses = {Scene.Lens};
+	Scene.Features.CopyEssentials(Empty);
+	Scene.Features.CameraName = "Fixture";
+	Scene.Features.FrameSize = Scene.Resolution;
+	Scene.Features.WorldToCamera = Scene.WorldToCamera;
+	ProjectTags(Corners, IDs, Scene.WorldToCamera * Scene.Lens.CameraToLens, Scene.Lens, Scene.Features.Lenses[0]);
+
+	FillImageData(Scene, RenderTags(Scene.Features.Lenses[0], Scene.Resolution));
+
+	//6cm baseline side by side camera
+	LensSettings Left = Scene.Lens, Right = Scene.Lens;
+	Left.CameraToLens = Affine3d(Matx33d::eye(), Vec3d(-0.03, 0, 0));
+	Right.CameraToLens = Affine3d(Matx33d::eye(), Vec3d(0.03, 0, 0));
+	Right.ROI = Scene.Lens.ROI + Point(Scene.Resolution.width, 0);
+	CameraImageData StereoEmpty;
+	StereoEmpty.lenses = {Left, Right};
+	Scene.StereoFeatures.CopyEssentials(StereoEmpty);
+	Scene.StereoFeatures.WorldToCamera = Scene.WorldToCamera;
+	ProjectTags(Corners, IDs, Scene.WorldToCamera * Left.CameraToLens, Left, Scene.StereoFeatures.Lenses[0]);
+	ProjectTags(Corners, IDs, Scene.WorldToCamera * Right.CameraToLens, Right, Scene.StereoFeatures.Lenses[1]);
+}
+
+//Recorded frame : the features come from a detection on the frame, the camera is wherever the board says
+static bool MakeRecordedFixture(Fixture &Scene, filesystem::path ImagePath, filesystem::path CalibrationPath)
+{
+	MakeSyntheticFixture(Scene);
+	CameraSettings Settings;
+	if (!readCameraParameters(CalibrationPath, Settings) || Settings.Lenses.size() != 1)
+	{
+		cerr << "Could not read a single lens calibration from " << CalibrationPath << endl;
+		return false;
+	}
+	Mat Image = imread(ImagePath.string(), Settings.IsMonochrome ? IMREAD_GRAYSCALE : IMREAD_COLOR);
+	if (Image.empty())
+	{
+		cerr << "Could not read " << ImagePath << endl;
+		return false;
+	}
+	Scene.Resolution = Image.size();
+	Scene.Lens = Settings.Lenses[0];
+	Scene.Lens.ROI = Rect(Point(0,0), Scene.Resolution);
+	FillImageData(Scene, Image.getUMat(ACCESS_READ).clone());
+	Scene.Features = CameraFeatureData();
+	Scene.Features.CopyEssentials(Scene.ImageData);
+	DetectAruco(Scene.ImageData, &Scene.Features);
+	float Surface;
+	Scene.Features.Lenses[0].WorldToLens = Affine3d::Identity();
+	Affine3d LensToBoard = Scene.Board.GetObjectTransform(Scene.Features.Lenses[0], Surface, 0);
+	Scene.WorldToCamera = LensToBoard.inv();
+	Scene.Features.WorldToCamera = Scene.WorldToCamera;
+	Scene.Features.Lenses[0].WorldToLens = Scene.WorldToCamera;
+	cerr << "Recorded frame has " << Scene.Features.Lenses[0].ArucoIndices.size() << " tags" << endl;
+	return true;
+}
+
+class KernelBenchmark
+{
+private:
+	LatencyStats Stats;
+	int Iterations;
+	string Filter;
+public:
+	KernelBenchmark(int InIterations, string InFilter)
+		:Iterations(InIterations), Filter(InFilter)
+	{
+	}
+
+	//Setup runs before every iteration and is not timed
+	void Run(const string &Name, function<void()> Kernel, function<void()> Setup = nullptr)
+	{
+		if (!Filter.empty() && Name.find(Filter) == string::npos)
+		{
+			return;
+		}
+		cerr << "Running " << Name << endl;
+		for (int i = 0; i < 3; i++)
+		{
+			if (Setup)
+			{
+				Setup();
+			}
+			Kernel();
+		}
+		for (int i = 0; i < Iterations; i++)
+		{
+			if (Setup)
+			{
+				Setup();
+			}
+			auto start = chrono::steady_clock::now();
+			Kernel();
+			Stats.Add(Name, chrono::steady_clock::now() - start);
+		}
+	}
+
+	const LatencyStats& GetStats() const
+	{
+		return Stats;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	SetExecutablePath(argv[0]);
+	const string keys =
+		"{help h ?     |  | print this message}"
+		"{image i      |  | recorded frame to run on instead of the synthetic scene, needs calibration}"
+		"{calibration c|  | calibration file of the recorded frame}"
+		"{iterations n | 100 | timed runs per kernel}"
+		"{filter f     |  | only run the kernels whose name contains this}"
+		"{out o        |  | file the json report is written to, stdout if empty}"
+		;
+	CommandLineParser parser(argc, argv, keys);
+	if (parser.has("help"))
+	{
+		parser.printMessage();
+		return EXIT_SUCCESS;
+	}
+	Fixture Scene;
+	if (parser.has("image"))
+	{
+		if (!MakeRecordedFixture(Scene, parser.get<string>("image"), parser.get<string>("calibration")))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		MakeSyntheticFixture(Scene);
+	}
+	KernelBenchmark Bench(max(1, parser.get<int>("iterations")), parser.get<string>("filter"));
+	CameraFeatureData Detected;
+
+	for (Size Segments : {Size(1,1), Size(2,2), Size(3,2), Size(4,3), Size(6,4)})
+	{
+		string name = "DetectArucoSegmented " + to_string(Segments.width) + "x" + to_string(Segments.height);
+		Bench.Run(name, [&](){DetectArucoSegmented(Scene.ImageData, &Detected, ArucoGridTuner::DefaultOverlap, Segments);},
+			[&](){Detected.Clear(); Detected.CopyEssentials(Scene.ImageData);});
+	}
+
+	float BaseReduction = GetReductionFactor();
+	for (float Reduction : {1.f, 0.5f, 0.25f})
+	{
+		SetReductionFactor(Reduction);
+		string name = "DetectAruco reduction " + to_string(Reduction).substr(0, 4);
+		Bench.Run(name, [&](){DetectAruco(Scene.ImageData, &Detected);},
+			[&](){Detected.Clear(); Detected.CopyEssentials(Scene.ImageData);});
+	}
+	SetReductionFactor(BaseReduction);
+
+	CameraFeatureData Merged;
+	Bench.Run("PolyCameraArucoMerge", [&](){PolyCameraArucoMerge(Merged);}, [&](){Merged = Scene.StereoFeatures;});
+
+	const LensFeatureData &Lens = Scene.Features.Lenses[0];
+	Bench.Run("TrackedObject::GetObjectTransform", [&]()
+	{
+		float Surface;
+		Scene.Board.GetObjectTransform(Lens, Surface, 0);
+	});
+	Bench.Run("TopTracker::GetObjectTransform", [&]()
+	{
+		float Surface;
+		for (auto &top : Scene.Tops)
+		{
+			top->GetObjectTransform(Lens, Surface, 0);
+		}
+	});
+
+	//the first top tracker tag, solved the way TopTracker does
+	auto TopTag = find(Lens.ArucoIndices.begin(), Lens.ArucoIndices.end(), Scene.Tops[0]->markers[0].number);
+	if (TopTag != Lens.ArucoIndices.end())
+	{
+		const ArucoCornerArray &ImagePoints = Lens.ArucoCorners[TopTag - Lens.ArucoIndices.begin()];
+		auto &ObjectPoints = Scene.Tops[0]->markers[0].GetObjectPointsNoOffset();
+		auto UpVector = GetAxis(Lens.WorldToLens.inv().rotation(), 2);
+		Bench.Run("SolvePnPUpright", [&]()
+		{
+			Mat rvec = Mat::zeros(3, 1, CV_64F), tvec = Mat::zeros(3, 1, CV_64F);
+			SolvePnPUpright(UpVector, 0.8, ObjectPoints, ImagePoints, Lens.CameraMatrix, Lens.DistanceCoefficients,
+				rvec, tvec, false, SOLVEPNP_IPPE_SQUARE);
+		});
+	}
+
+	auto CamSettings = make_shared<VideoCaptureCameraSettings>();
+	CamSettings->Resolution = Scene.Resolution;
+	CamSettings->Lenses = {Scene.Lens};
+	CamSettings->WantUndistortion = true;
+	CamSettings->StartType = CameraStartType::PLAYBACK;
+	CamSettings->DeviceInfo.device_paths.push_back("fixture");
+	FixtureCamera Cam(CamSettings, Scene.ImageData.Image);
+	Cam.StartFeed();
+	Cam.NextFrame();
+	Bench.Run("Camera::Undistort", [&](){Cam.Undistort();});
+	vector<Rect> TagROIs;
+	for (auto &corners : Lens.ArucoCorners)
+	{
+		Rect bounds = boundingRect(corners);
+		TagROIs.push_back(bounds + Size(bounds.width, bounds.height) - Point(bounds.width/2, bounds.height/2));
+	}
+	Bench.Run("Camera::Undistort ROIs", [&](){Cam.Undistort(TagROIs);});
+
+	vector<ObjectData> Objects = Scene.Board.ToObjectData();
+	for (auto &top : Scene.Tops)
+	{
+		auto topdata = top->ToObjectData();
+		Objects.insert(Objects.end(), topdata.begin(), topdata.end());
+	}
+	for (size_t i = 0; i < Lens.ArucoIndices.size(); i++)
+	{
+		Objects.emplace_back(ObjectType::Tag, "Tag " + to_string(Lens.ArucoIndices[i]), 0.1*i, 0.05*i, 0);
+	}
+	JsonListener Listener(nullptr, nullptr);
+	Bench.Run("JsonListener::ObjectToJson", [&]()
+	{
+		for (auto &object : Objects)
+		{
+			Listener.ObjectToJson(object);
+		}
+	});
+
+	nlohmann::json report;
+	report["fixture"] = parser.has("image") ? parser.get<string>("image") : string("synthetic");
+	report["resolution"] = {Scene.Resolution.width, Scene.Resolution.height};
+	report["tags"] = Lens.ArucoIndices.size();
+	report["objects"] = Objects.size();
+	report["iterations"] = max(1, parser.get<int>("iterations"));
+	report["kernels"] = Bench.GetStats().ToJson();
+	string outpath = parser.get<string>("out");
+	if (outpath.empty())
+	{
+		cout << report.dump(1, '\t') << endl;
+		return EXIT_SUCCESS;
+	}
+	ofstream file(outpath);
+	file << report.dump(1, '\t');
+	return file.good() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -4,6 +4,7 @@
 #include <ArucoPipeline/TrackedObject.hpp>
 #include <ArucoPipeline/ArucoTypes.hpp>
 #include <array>
+#include <memory>
 
 struct ResolvedLocation
 {
@@ -23,6 +24,17 @@ struct ResolvedLocation
 	static cv::Affine3d IntersectMultiview(std::vector<ResolvedLocation> Views);
 };
 
+//What the camera workers need from a tracker, copied by the runner when it dispatches a frame
+//The workers only read it, so they never touch the objects the runner is solving or registering
+struct TrackerSnapshot
+{
+	std::vector<std::shared_ptr<TrackedObject>> StaticObjects; //Non relative static objects, they are never moved by the solve
+	std::vector<std::vector<cv::Point3d>> PointsOfInterest;
+	double LargestArucoSize = 0;
+
+	bool SolveCameraLocation(CameraFeatureData& CameraData) const;
+};
+
 //Class that handles the objects, and holds information about each tag's size
 //Registered objects will have their locations solved and turned into a vector of ObjectData for display and data sending
 class ObjectTracker
@@ -32,6 +44,8 @@ private:
 	std::array<int, ARUCO_DICT_SIZE> ArucoMap; //Which object owns the tag at index i ? objects[ArucoMap[TagID]]
 	std::array<double, ARUCO_DICT_SIZE> ArucoSizes; //Size of the aruco tag
 
+	static constexpr double MaxTimeAlignment = 0.1; //s, views further apart in time than this are not extrapolated further
+
 public:
 	ObjectTracker(/* args */);
 	~ObjectTracker();
@@ -42,6 +56,11 @@ public:
 
 	bool SolveCameraLocation(CameraFeatureData& CameraData);
 
+	//Copy of what the camera workers read, the points of interest are only gathered if asked for
+	std::shared_ptr<const TrackerSnapshot> GetSnapshot(bool WithPointsOfInterest) const;
+
+	//Cameras don't capture at the same time : each view is moved to the time of the newest frame using the object's velocity before being merged
+	//Tick is used as the reference time for cameras that don't know when their frame was captured
 	void SolveLocationsPerObject(std::vector<CameraFeatureData>& CameraData, TrackedObject::TimePoint Tick);
 
 
@@ -52,6 +71,9 @@ public:
 
 	double GetArucoSize(int number);
 
+	//Side of the biggest tag owned by a registered object, 0 if none
+	double GetLargestArucoSize() const;
+
 	std::vector<std::vector<cv::Point3d>> GetPointsOfInterest() const;
 
 private:
@@ -89,8 +89,13 @@ public:
 protected:
 	cv::Affine3d Location;
 	TimePoint LastSeenTick;
+	cv::Vec3d Velocity; //World space, m/s, smoothed from successive locations
 	cv::KalmanFilter LocationFilter;
 
+	static constexpr double VelocitySmoothing = 0.5; //weight of the newest measurement
+	static constexpr double MaxVelocityGap = 0.5; //s, locations further apart than this reset the velocity
+	static constexpr double MaxSpeed = 5; //m/s, faster measurements are considered jumps and ignored
+
 public:
 
 	TrackedObject();
@@ -98,6 +103,7 @@ public:
 	//Set location. Bypass kalman filter if tick is UINT64_MAX
 	virtual bool SetLocation(cv::Affine3d InLocation, TimePoint Tick);
 	TimePoint GetLastSeenTick() const { return LastSeenTick; }
+	cv::Vec3d GetVelocity() const { return Velocity; }
 
 	virtual bool ShouldBeDisplayed(TimePoint Tick) const;
 	virtual cv::Affine3d GetLocation() const;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <optional>
+
+class Camera;
+struct CameraImageData;
+struct CameraFeatureData;
+
+//Brightness and gain loop driven by the pixels of the detected aruco tags instead of the whole frame
+//Tries to put the white of the tags just under saturation while the black stays dark, which is what gives the detector the most contrast
+//Brightness is used first, gain only once brightness is at its limit, as gain also amplifies noise
+class AutoExposureController
+{
+public:
+	struct TagExposure
+	{
+		int Dark = 0, Bright = 0; //10th and 90th percentile of the tag pixels
+		float Saturated = 0; //Fraction of tag pixels that are clipped
+		int NumTags = 0;
+
+		int GetContrast() const
+		{
+			return Bright - Dark;
+		}
+	};
+
+	int TargetBright = 200;
+	int Tolerance = 20;
+	//Frames to wait after a change, the camera takes a few frames to apply it
+	int SettleFrames = 4;
+	int MinBrightness = -64, MaxBrightness = 64;
+	int MinGain = 0, MaxGain = 255;
+
+private:
+	int FramesSinceChange = 0;
+	std::optional<TagExposure> LastExposure;
+
+public:
+	static std::optional<TagExposure> Measure(const CameraImageData &ImageData, const CameraFeatureData &FeatureData);
+
+	std::optional<TagExposure> GetLastExposure() const
+	{
+		return LastExposure;
+	}
+
+	//Measure the tags of this frame and queue a brightness or gain correction on the camera if needed
+	//Holds the current values when no tag is seen
+	void Update(Camera &Cam, const CameraImageData &ImageData, const CameraFeatureData &FeatureData);
+};
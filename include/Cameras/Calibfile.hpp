@@ -11,6 +11,11 @@ void writeCameraParameters(std::filesystem::path path, cv::Mat camMatrix, cv::Ma
 
 bool readCameraParameters(std::filesystem::path path, CameraSettings &Settings);
 
+//Same json as the calibration files, for when the settings are stored inside another file
+bool CameraParametersFromString(const std::string &Contents, CameraSettings &Settings);
+
+std::string CameraParametersToString(const CameraSettings &Settings);
+
 void writeCameraParameters(std::filesystem::path path, const CameraSettings &Settings);
 
 void MigrateCameraParameters();
\ No newline at end of file
@@ -6,13 +6,26 @@
 #include <string>   // for strings
 #include <vector>
 #include <chrono>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <optional>
 #include <opencv2/core.hpp>		// Basic OpenCV structures (Mat, Scalar)
 #include <opencv2/core/affine.hpp>
 
 #include <Cameras/ImageSource.hpp>
 #include <Cameras/ImageTypes.hpp>
+#include <Cameras/FramePool.hpp>
+#include <Cameras/CameraControls.hpp>
+#include <Cameras/AutoExposure.hpp>
+#include <Cameras/CameraRecorder.hpp>
+#include <Cameras/ReplayClock.hpp>
+#include <Misc/TripleBuffer.hpp>
 #include <ArucoPipeline/TrackedObject.hpp>
+#include <DetectFeatures/ArucoDetect.hpp>
+#include <DetectFeatures/ArucoGridTuner.hpp>
 
 class Camera;
 struct CameraImageData;
@@ -51,12 +64,52 @@ protected:
 	bool HasUndistortionMaps;
 	
 	std::vector<std::pair<cv::UMat, cv::UMat>> UndistMaps;
-	cv::UMat LastFrameDistorted, LastFrameUndistorted;
-	std::optional<std::chrono::steady_clock::time_point> record_start;
-	std::unique_ptr<cv::VideoWriter> RecordOutput;
-	std::unique_ptr<std::ofstream> TimestampsOutput;
+	//Written by Grab and Read. When the capture thread runs, it owns it
+	cv::UMat LastFrameDistorted;
+	//Compressed frame LastFrameDistorted was decoded from, only filled by Read when KeepCompressed is set
+	cv::Mat LastCompressed;
+	std::atomic_bool KeepCompressed = false;
+
+	struct CapturedFrame
+	{
+		cv::UMat Image;
+		std::chrono::steady_clock::time_point GrabTime;
+		unsigned int FrameNumber = 0;
+		//MJPEG bytes the image was decoded from, only kept while recording raw
+		cv::Mat Compressed;
+		//Time spent in Grab and Read for this frame, zero when a frame is presented again
+		std::chrono::steady_clock::duration GrabDuration{}, ReadDuration{};
+	};
+	//Frame being processed, set by NextFrame and used by Undistort, GetFrame and Record
+	CapturedFrame Processing;
+	cv::UMat LastFrameUndistorted;
+	//Parts of LastFrameUndistorted that were undistorted, empty if it was done on the whole frame
+	std::vector<cv::Rect> UndistortedROIs;
+	//Buffers backing LastFrameDistorted (capture side) and LastFrameUndistorted (processing side)
+	FramePool Frames, UndistortedFrames;
+
+	//Continuous capture : a thread drains the device into LatestFrame, processing takes whatever is newest
+	std::unique_ptr<std::thread> CaptureThread;
+	std::atomic_bool CaptureKilled = false;
+	TripleBuffer<CapturedFrame> LatestFrame;
+	std::mutex NewFrameMutex; //Only used to sleep until a frame is published, the buffers are swapped without it
+	std::condition_variable NewFrameCondition;
+	std::atomic<uint64_t> DroppedFrames = 0;
+
+	//Brightness and gain writes, applied between two frames by whoever grabs them, never inline in Read
+	CameraControlQueue Controls;
+	std::atomic_bool AutoControlled = false;
+	//Global brightness and gain last followed, only used by the thread that grabs
+	int FollowedBrightness = 0, FollowedGain = 0;
+	bool WasAutoControlled = false;
+	//Created by the first call to Record
+	std::unique_ptr<CameraRecorder> Recorder;
+	//Set when replaying a recording in step with other cameras, Grab then follows it instead of reading every frame
+	std::shared_ptr<ReplayClock> Replay;
+	//The location is written by the camera worker and read by the runner
+	mutable std::mutex LocationMutex;
 public:
-	int errors;
+	std::atomic<int> errors;
 	//status
 	bool connected;
 	bool grabbed;
@@ -65,6 +118,15 @@ public:
 
 	bool PositionLocked;
 
+	//Where the tags were seen on the last frame, only used by the thread processing this camera
+	ArucoTrackingState ArucoTracking;
+
+	//Segment grid of the full sweeps, tuned from their timings, only used by the thread processing this camera
+	ArucoGridTuner ArucoGrid;
+
+	//Brightness and gain from the tags seen, only used by the thread processing this camera
+	AutoExposureController AutoExposure;
+
 public:
 
 	Camera(std::shared_ptr<CameraSettings> InSettings)
@@ -82,6 +144,31 @@ public:
 protected:
 	void RegisterError();
 	void RegisterNoError();
+
+	//Adapt resolution and calibration to frames that are decoded Reduction times smaller than what the camera sends
+	void ApplyDecodeReduction(int Reduction);
+
+	//imdecode flags to decode luma only, Reduction times smaller
+	static int GetGrayscaleDecodeFlags(int Reduction);
+
+	//Creates the undistortion maps if needed, returns false if the calibration can't be used for undistortion
+	bool UpdateUndistortionMaps();
+
+	void CaptureThreadEntryPoint();
+
+	//Start values of the controls, from the global settings. The device should be started with GetControl's values
+	void ResetControls();
+
+	//Write a control to the device, only called between two frames by the thread that grabs
+	virtual bool ApplyControl(CameraControl Control, int Value)
+	{
+		(void)Control;
+		(void)Value;
+		return false;
+	}
+
+	//Follows the global brightness and gain unless auto controlled, then writes whatever is queued
+	void ApplyPendingControls();
 public:
 
 	std::string GetName()
@@ -105,6 +192,12 @@ public:
 
 	void SetPositionLock(bool state);
 
+	virtual bool SetLocation(cv::Affine3d InLocation, TimePoint Tick) override;
+
+	virtual cv::Affine3d GetLocation() const override;
+
+	virtual bool ShouldBeDisplayed(TimePoint Tick) const override;
+
 	void UpdateFrameNumber();
 
 	//Lock a frame to be capture at this time
@@ -114,11 +207,86 @@ public:
 	//Retrieve or read a frame
 	virtual bool Read();
 
+	//Start grabbing and reading continuously on a separate thread, only the latest frame is kept
+	//Must be stopped before the derived class is destroyed
+	void StartCaptureThread();
+
+	void StopCaptureThread();
+
+	bool HasCaptureThread() const
+	{
+		return CaptureThread != nullptr;
+	}
+
+	//Frames captured by the capture thread that were replaced before being processed
+	uint64_t GetDroppedFrames() const
+	{
+		return DroppedFrames.load();
+	}
+
+	//Ask for a control to be changed, can be called from any thread. Repeated writes before the next frame are coalesced
+	void QueueControl(CameraControl Control, int Value)
+	{
+		Controls.Push(Control, Value);
+	}
+
+	//Last value asked for, it may not have reached the device yet
+	int GetControl(CameraControl Control) const
+	{
+		return Controls.GetRequested(Control);
+	}
+
+	//When set, the global brightness and gain are ignored and the controls are only changed through QueueControl
+	void SetAutoControlled(bool Value)
+	{
+		AutoControlled = Value;
+	}
+
+	//Only for playback cameras that know when their frames were recorded, before the first frame is taken
+	void SetReplayClock(std::shared_ptr<ReplayClock> InClock)
+	{
+		Replay = InClock;
+	}
+
+	//Recorded time in nanoseconds of the frame the next Grab would move to, nullopt for live cameras or at the end of a recording
+	virtual std::optional<int64_t> GetNextRecordedTime() const
+	{
+		return std::nullopt;
+	}
+
+	//Take the next frame to process : the freshest from the capture thread if it runs, otherwise grab and read one now
+	bool NextFrame(std::chrono::milliseconds Timeout = std::chrono::milliseconds(1000));
+
+	//Grab and read time of the frame being processed, zero if it was already processed
+	std::chrono::steady_clock::duration GetGrabDuration() const
+	{
+		return Processing.GrabDuration;
+	}
+
+	std::chrono::steady_clock::duration GetReadDuration() const
+	{
+		return Processing.ReadDuration;
+	}
+
 	virtual void Undistort();
 
+	//Only undistort the given rectangles, in undistorted frame coordinates. The rest of the undistorted frame is left as is
+	virtual void Undistort(const std::vector<cv::Rect> &ROIs);
+
 	virtual CameraImageData GetFrame(bool Distorted) const override;
 
 	virtual std::vector<ObjectData> ToObjectData() const override;
 
+	//Hands the frame being processed to the recorder thread, never waits on the encoder
 	virtual void Record(std::filesystem::path rootPath, int RecordIdx);
+
+	//Frames the recorder had to drop because the encoder couldn't keep up, nullopt if not recording
+	std::optional<uint64_t> GetRecordDroppedFrames() const
+	{
+		if (!Recorder)
+		{
+			return std::nullopt;
+		}
+		return Recorder->GetDroppedFrames();
+	}
 };
\ No newline at end of file
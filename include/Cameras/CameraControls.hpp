@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <cstdint>
+
+enum class CameraControl : uint8_t
+{
+	Brightness = 0,
+	Gain,
+	Count
+};
+
+//Control writes waiting to be applied by whoever owns the device, between two frames
+//Writing a control again before it was applied replaces the pending value, so a slider drag ends up as a single write
+class CameraControlQueue
+{
+private:
+	static constexpr size_t NumControls = (size_t)CameraControl::Count;
+
+	mutable std::mutex Mutex;
+	std::array<std::optional<int>, NumControls> Pending;
+	//Last value asked for, applied or not
+	std::array<int, NumControls> Requested{};
+	std::atomic_bool HasPending = false;
+
+public:
+	void Push(CameraControl Control, int Value)
+	{
+		size_t idx = (size_t)Control;
+		std::unique_lock lock(Mutex);
+		if (!Pending[idx].has_value() && Requested[idx] == Value)
+		{
+			return;
+		}
+		Pending[idx] = Value;
+		Requested[idx] = Value;
+		HasPending = true;
+	}
+
+	//Value the device was started with, nothing gets written
+	void SetCurrent(CameraControl Control, int Value)
+	{
+		size_t idx = (size_t)Control;
+		std::unique_lock lock(Mutex);
+		Pending[idx].reset();
+		Requested[idx] = Value;
+	}
+
+	int GetRequested(CameraControl Control) const
+	{
+		std::unique_lock lock(Mutex);
+		return Requested[(size_t)Control];
+	}
+
+	//Calls Function(Control, Value) for every pending write, outside of the lock
+	template<class F>
+	void Apply(F &&Function)
+	{
+		if (!HasPending.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		std::array<std::optional<int>, NumControls> Taken;
+		{
+			std::unique_lock lock(Mutex);
+			Taken.swap(Pending);
+			HasPending = false;
+		}
+		for (size_t i = 0; i < NumControls; i++)
+		{
+			if (Taken[i].has_value())
+			{
+				Function((CameraControl)i, *Taken[i]);
+			}
+		}
+	}
+};
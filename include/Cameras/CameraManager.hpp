@@ -6,6 +6,7 @@
 #include <iostream>
 #include <shared_mutex>
 #include <memory>
+#include <chrono>
 
 #include <Cameras/Camera.hpp>
 #include <Transport/Task.hpp>
@@ -18,9 +19,10 @@
 class CameraManager : public Task
 {
 protected:
-	//Boths paths are protected by pathmutex
+	//All paths are protected by pathmutex
 	std::set<std::string> usedpaths; //Paths used by the cameras
 	std::set<std::string> blockedpaths; //paths that have been tried but failed at some point during init, so that we don't try again
+	std::set<std::string> removedpaths; //Paths of devices that disappeared, cameras using them are detached on the next Tick
 
 	std::shared_mutex pathmutex, cammutex;
 
@@ -58,6 +60,23 @@ public:
 
 	std::vector<Camera*> GetCameras();
 
+	//Time the frames requested after this Tick are considered grabbed at
+	virtual std::chrono::steady_clock::time_point GetTickTime() const
+	{
+		return std::chrono::steady_clock::now();
+	}
+
+	//Cameras replay recordings, ticks should not be slowed down when nobody is watching
+	virtual bool IsReplay() const
+	{
+		return false;
+	}
+
 protected:
+	//Called by Tick after cameras were detached, so that their devices can be picked up again
+	virtual void OnCamerasDetached()
+	{
+	}
+
 	virtual void ThreadEntryPoint() override;
 };
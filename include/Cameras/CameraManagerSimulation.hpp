@@ -1,14 +1,23 @@
 #pragma once
 
 #include <Cameras/CameraManager.hpp>
+#include <Cameras/ReplayClock.hpp>
+#include <optional>
 
+//Replays the recordings listed in a scenario as cameras
+//Cameras that know when their frames were recorded share a ReplayClock, moved forward on every Tick,
+//so that each tick processes the frames that were seen together, at recorded speed or as fast as possible
 class CameraManagerSimulation : public CameraManager
 {
 private:
 	std::string ScenarioPath;
+	//Clock of the scenario being replayed, only used by Tick. NewClock is handed over with the cameras, under cammutex
+	std::shared_ptr<ReplayClock> Clock, NewClock;
+	//Replay speed, from the config if not set
+	std::optional<bool> RealTime;
 public:
-	CameraManagerSimulation(std::string InScenarioPath)
-		:CameraManager(), ScenarioPath(InScenarioPath)
+	CameraManagerSimulation(std::string InScenarioPath, std::optional<bool> InRealTime = std::nullopt)
+		:CameraManager(), ScenarioPath(InScenarioPath), RealTime(InRealTime)
 	{
 
 	}
@@ -18,6 +27,16 @@ public:
 
 	}
 
+	//Registers the new cameras then moves the timeline to the next recorded frame
+	virtual std::vector<Camera*> Tick() override;
+
+	virtual std::chrono::steady_clock::time_point GetTickTime() const override;
+
+	virtual bool IsReplay() const override
+	{
+		return true;
+	}
+
 protected:
 	virtual void ThreadEntryPoint() override;
 };
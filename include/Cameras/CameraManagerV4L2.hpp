@@ -1,24 +1,24 @@
 #pragma once
 
+#include <chrono>
 #include "Cameras/CameraManager.hpp"
 
+//Starts a camera for every V4L2 device that passes the filter
+//Devices are only enumerated when something changes in /dev (inotify), when a camera was detached or when leaving idle
 class CameraManagerV4L2 : public CameraManager
 {
 private:
 	CameraStartType Start;
 	std::string Filter;
 	bool AllowNoCalib;
-public:
-	CameraManagerV4L2(CameraStartType InStart, std::string InFilter, bool InAllowNoCalib = false)
-		:CameraManager(), Start(InStart), Filter(InFilter), AllowNoCalib(InAllowNoCalib)
-	{
-
-	}
+	int WakeFd = -1; //eventfd used to ask the scan thread for a rescan
 
-	virtual ~CameraManagerV4L2()
-	{
+	//udev creates the nodes of a camera and then fixes their permissions in a burst, wait for it to settle before scanning
+	static constexpr std::chrono::milliseconds SettleDelay{100};
+public:
+	CameraManagerV4L2(CameraStartType InStart, std::string InFilter, bool InAllowNoCalib = false);
 
-	}
+	virtual ~CameraManagerV4L2();
 
 	//Check if the name can fit the filter to blacklist or whitelist certain cameras based on name
 	static bool DeviceInFilter(v4l2::devices::DEVICE_INFO device, std::string Filter);
@@ -28,6 +28,19 @@ public:
 
 	static std::vector<VideoCaptureCameraSettings> autoDetectCameras(CameraStartType Start, std::string Filter, bool silent = true);
 
+	virtual void SetIdle(bool value) override;
+
 protected:
+	//Ask the scan thread to enumerate the devices again
+	void RequestRescan();
+
+	virtual void OnCamerasDetached() override;
+
+	//Start cameras on the devices that are not used or blocked yet
+	void Rescan();
+
+	//Reads the pending inotify events, marks removed video devices. Returns true if a video device changed
+	bool HandleDeviceEvents(int InotifyFd);
+
 	virtual void ThreadEntryPoint() override;
 };
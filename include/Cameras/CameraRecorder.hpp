@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <Cameras/ImageTypes.hpp>
+#include <Cameras/RawRecording.hpp>
+#include <Misc/BoundedQueue.hpp>
+
+//Writes a camera's frames to a video and a timestamps file, or to a raw recording, on its own thread
+//Frames are queued by reference, the buffer stays out of the camera's frame pool until it has been encoded
+//When the encoder can't keep up the oldest queued frames are dropped, the processing side never waits on it
+class CameraRecorder
+{
+public:
+	struct Frame
+	{
+		cv::UMat Image;
+		cv::Mat Compressed; //If set and recording raw, stored instead of the image
+		std::chrono::steady_clock::time_point GrabTime;
+		unsigned int FrameNumber = 0;
+	};
+
+private:
+	std::filesystem::path Folder;
+	CameraSettings Settings;
+	std::string Name;
+	bool Raw;
+	BoundedQueue<Frame> Queue;
+	size_t Capacity;
+	std::unique_ptr<std::thread> Thread;
+	std::atomic<uint64_t> Dropped = 0, Written = 0;
+
+	//Only used by the recorder thread
+	std::unique_ptr<cv::VideoWriter> Output;
+	std::unique_ptr<RawRecording::Writer> RawOutput;
+	std::unique_ptr<std::ofstream> TimestampsOutput;
+
+	bool Open(const Frame &First);
+
+	void WriteRaw(const Frame &InFrame);
+
+	void ThreadEntryPoint();
+
+public:
+	CameraRecorder(std::filesystem::path InFolder, const CameraSettings &InSettings, std::string InName, bool InRaw = false, size_t InCapacity = 8);
+
+	//Writes what is still queued then closes the files
+	~CameraRecorder();
+
+	//Never blocks
+	void Push(Frame InFrame);
+
+	uint64_t GetDroppedFrames() const
+	{
+		return Dropped.load();
+	}
+
+	uint64_t GetWrittenFrames() const
+	{
+		return Written.load();
+	}
+
+	size_t GetQueuedFrames() const
+	{
+		return Queue.Size();
+	}
+
+	//Most frames held at once, the camera's pool must have that many buffers on top of its own
+	size_t GetCapacity() const
+	{
+		return Capacity;
+	}
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <opencv2/core.hpp>
+#include <Cameras/ImageTypes.hpp>
+
+//What a device actually gave when asked for a format, persisted in cache/camera_formats.json
+//Lets a known camera be asked for the format it settled on, instead of the configured one the driver has to approximate
+struct CachedCameraFormat
+{
+	cv::Size Resolution;
+	double Framerate;
+	int Fourcc;
+};
+
+//Identifies a device and the format that was asked of it
+std::string GetFormatCacheKey(const VideoCaptureCameraSettings &Settings, int Fourcc);
+
+//Safe to call from several threads
+std::optional<CachedCameraFormat> GetCachedFormat(const std::string &Key);
+
+void SetCachedFormat(const std::string &Key, const CachedCameraFormat &Format);
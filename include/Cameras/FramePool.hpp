@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+//Ring of frame buffers owned by a camera, so that capture and undistortion don't allocate in steady state
+//A buffer is only handed out again once every other holder (published snapshots, recorder, ...) has released it
+//Get is only called by a single thread : the capture thread for captured frames, the camera's worker for undistorted ones
+//SetMaxFrames can be called from any thread
+class FramePool
+{
+private:
+	std::vector<cv::UMat> Frames;
+	std::atomic<size_t> MaxFrames;
+	size_t NextIndex = 0;
+
+	static std::atomic<uint64_t> TotalAllocations;
+
+	static bool IsFree(const cv::UMat &Frame);
+
+public:
+	static constexpr size_t DefaultMaxFrames = 8;
+
+	FramePool(size_t InMaxFrames = DefaultMaxFrames)
+		:MaxFrames(InMaxFrames)
+	{}
+
+	//Room for buffers held somewhere else for a while (recorder queue...), can be called from any thread
+	void SetMaxFrames(size_t InMaxFrames)
+	{
+		MaxFrames = InMaxFrames;
+	}
+
+	//Returns a buffer of the given size and type that nobody else holds. Allocates only if none is available
+	cv::UMat Get(cv::Size Size, int Type);
+
+	//Number of frame buffers allocated by all pools since startup
+	static uint64_t GetTotalAllocations()
+	{
+		return TotalAllocations.load();
+	}
+};
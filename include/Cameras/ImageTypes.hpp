@@ -72,7 +72,8 @@ enum class CameraStartType
 {
 	ANY = 0,
 	GSTREAMER_CPU,
-	PLAYBACK //playback from a file
+	PLAYBACK, //playback from a file
+	V4L2 //talks to the driver directly, frames are timestamped by the driver
 };
 
 struct VideoCaptureCameraSettings : public CameraSettings
@@ -98,6 +99,8 @@ struct CameraImageData
 
 	std::vector<LensSettings> lenses;
 	std::chrono::steady_clock::time_point GrabTime;
+	//If not empty, only these parts of the image are up to date (ROI-only undistortion)
+	std::vector<cv::Rect> ValidROIs;
 	bool Distorted;
 	bool Valid = false;
 };
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <opencv2/core.hpp>
+
+#include <Cameras/ImageTypes.hpp>
+
+//Lossless recording of the frames a camera captured, so that replays see exactly the same pixels
+//Layout : FileHeader, camera settings json, then one FrameHeader + payload per frame, appended as they come
+//On a clean close an index of every frame and a Trailer are appended. Without them the frames are found by walking the chunks
+//Everything is little-endian and packed, payloads are padded to 8 bytes
+namespace RawRecording
+{
+	constexpr char Extension[] = ".cyraw";
+	constexpr uint8_t Magic[4] = {'C', 'Y', 'R', 'W'};
+	constexpr uint8_t FrameMagic[4] = {'F', 'R', 'M', '0'};
+	constexpr uint8_t IndexMagic[4] = {'C', 'Y', 'R', 'I'};
+	constexpr uint16_t Version = 1;
+	//Frames bigger than this in either dimension are taken as a corrupt header
+	constexpr uint32_t MaxDimension = 16384;
+
+	enum PixelFormat : uint16_t
+	{
+		Gray8 = 1, //Width*Height bytes
+		BGR8 = 2, //Width*Height*3 bytes
+		MJPEG = 3 //A jpeg as sent by the camera, Width and Height are the size it was decoded to while recording
+	};
+
+#pragma pack(push, 1)
+	struct FileHeader
+	{
+		uint8_t Magic[4];
+		uint16_t Version;
+		uint16_t Reserved;
+		uint32_t SettingsLength; //Bytes of settings json following the header
+		uint32_t Reserved2;
+	};
+
+	struct FrameHeader
+	{
+		uint8_t Magic[4];
+		uint16_t Format; //PixelFormat
+		uint16_t Reserved;
+		uint32_t Width, Height;
+		uint32_t FrameNumber;
+		uint32_t Length; //Payload bytes, without padding
+		int64_t Timestamp; //ns, steady clock (driver timestamp when the camera gives one)
+	};
+
+	struct IndexEntry
+	{
+		uint64_t Offset; //Of the FrameHeader from the start of the file
+		int64_t Timestamp;
+	};
+
+	struct Trailer
+	{
+		uint64_t IndexOffset;
+		uint32_t Count;
+		uint8_t Magic[4];
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(FileHeader) == 16);
+	static_assert(sizeof(FrameHeader) == 32);
+	static_assert(sizeof(IndexEntry) == 16);
+	static_assert(sizeof(Trailer) == 16);
+
+	//Append-only writer, one per recording
+	class Writer
+	{
+	private:
+		FILE* File = nullptr;
+		uint64_t Offset = 0;
+		std::vector<IndexEntry> Index;
+
+		bool Write(const void* Data, size_t Length);
+
+	public:
+		Writer() = default;
+		Writer(const Writer&) = delete;
+		~Writer();
+
+		bool Open(std::filesystem::path Path, const CameraSettings &Settings);
+
+		bool IsOpen() const
+		{
+			return File != nullptr;
+		}
+
+		bool Append(PixelFormat Format, cv::Size Size, const void* Data, size_t Length, int64_t Timestamp, uint32_t FrameNumber);
+
+		//Appends the image, Gray8 or BGR8 depending on its channels
+		bool Append(const cv::Mat &Image, int64_t Timestamp, uint32_t FrameNumber);
+
+		//Writes the index and the trailer
+		void Close();
+	};
+
+	struct FrameView
+	{
+		PixelFormat Format;
+		cv::Size Size;
+		uint32_t FrameNumber;
+		int64_t Timestamp;
+		const uint8_t* Data; //Points into the mapping, valid as long as the reader
+		size_t Length;
+	};
+
+	//Maps the whole file read-only, frames are read in place
+	class Reader
+	{
+	private:
+		int fd = -1;
+		const uint8_t* Mapping = nullptr;
+		size_t MappingLength = 0;
+		std::vector<IndexEntry> Index;
+		std::string SettingsJson;
+
+		//Rebuilds the index of a recording that wasn't closed properly
+		void ScanFrames(uint64_t Start);
+
+	public:
+		Reader() = default;
+		Reader(const Reader&) = delete;
+		~Reader();
+
+		bool Open(std::filesystem::path Path);
+
+		void Close();
+
+		//Embedded settings, Resolution is the size the frames were recorded at
+		bool GetSettings(CameraSettings &Settings) const;
+
+		size_t GetFrameCount() const
+		{
+			return Index.size();
+		}
+
+		//Fails past the end, and on frames whose header doesn't match their payload
+		std::optional<FrameView> GetFrame(size_t FrameIndex) const;
+	};
+}
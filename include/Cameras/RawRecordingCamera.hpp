@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <chrono>
+#include <optional>
+#include <opencv2/core.hpp>
+
+#include <Cameras/Camera.hpp>
+#include <Cameras/ImageTypes.hpp>
+#include <Cameras/RawRecording.hpp>
+
+//Replays a .cyraw recording, frame by frame and bit-exact
+//Frames are read in place from the mapped file, only MJPEG frames need decoding
+//The settings stored in the recording are used unless the scenario gives a valid calibration
+class RawRecordingCamera : public Camera
+{
+private:
+	RawRecording::Reader Recording;
+	size_t NextIndex = 0;
+	std::optional<RawRecording::FrameView> Current;
+	//Found on the first MJPEG frame, when the recording was decoded to a reduced size
+	std::optional<int> DecodeFlags;
+	//Recorded timestamps are replayed relative to when the replay started
+	std::chrono::steady_clock::time_point ReplayStart;
+	int64_t FirstTimestamp = 0;
+
+	bool DecodeMJPEG(const RawRecording::FrameView &Frame, cv::UMat &Target);
+
+	virtual bool ApplyControl(CameraControl Control, int Value) override;
+
+public:
+	RawRecordingCamera(std::shared_ptr<VideoCaptureCameraSettings> InSettings)
+		:Camera(InSettings)
+	{
+	}
+
+	~RawRecordingCamera()
+	{
+		StopCaptureThread();
+	}
+
+	virtual bool StartFeed() override;
+
+	//Move to the next recorded frame, fails at the end of the recording
+	virtual bool Grab() override;
+
+	virtual bool Read() override;
+
+	//Recording timestamps are in the recording machine's steady clock, so recordings made together stay aligned
+	virtual std::optional<int64_t> GetNextRecordedTime() const override;
+};
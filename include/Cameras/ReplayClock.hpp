@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+
+//Timeline shared by the cameras of a replay, in recorded nanoseconds
+//The camera manager moves it forward once per tick, to the next recorded frame of any camera,
+//and every camera presents its newest frame at or before that time, so that frame sets stay aligned.
+//Capture times are derived from the recorded timestamps only, so a replay gives the same results whatever the speed
+class ReplayClock
+{
+public:
+	using Clock = std::chrono::steady_clock;
+private:
+	std::atomic<int64_t> Now = 0;
+	std::atomic_bool Started = false;
+	//Where recorded time 0 is, set when the replay starts
+	Clock::time_point Epoch;
+	//Wait for the wall clock to catch up with the timeline instead of running as fast as possible
+	bool RealTime;
+
+public:
+	ReplayClock(bool InRealTime)
+		:RealTime(InRealTime)
+	{}
+
+	bool IsStarted() const
+	{
+		return Started;
+	}
+
+	bool IsRealTime() const
+	{
+		return RealTime;
+	}
+
+	//Not thread safe, called by the camera manager while no camera is grabbing
+	void Start(int64_t First)
+	{
+		Epoch = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(First));
+		Now = First;
+		Started = true;
+	}
+
+	void Advance(int64_t To)
+	{
+		if (To > Now)
+		{
+			Now = To;
+		}
+		if (RealTime)
+		{
+			std::this_thread::sleep_until(GetTimePoint());
+		}
+	}
+
+	//Recorded time being presented
+	int64_t GetTime() const
+	{
+		return Now;
+	}
+
+	Clock::time_point ToTimePoint(int64_t Recorded) const
+	{
+		return Epoch + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(Recorded));
+	}
+
+	Clock::time_point GetTimePoint() const
+	{
+		return ToTimePoint(Now);
+	}
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <Cameras/Camera.hpp>
+#include <Cameras/ImageTypes.hpp>
+
+//Camera that talks to the V4L2 driver directly instead of going through VideoCapture
+//Frames land in a ring of mmap'd driver buffers and are dequeued without blocking,
+//GrabTime is the driver timestamp of the frame instead of the time it was picked up
+class V4L2Camera : public Camera
+{
+private:
+	struct MappedBuffer
+	{
+		void* Start = nullptr;
+		size_t Length = 0;
+	};
+
+	int fd = -1;
+	std::vector<MappedBuffer> Buffers;
+	//Buffer held by us between Grab and Read, -1 if none
+	int DequeuedIndex = -1;
+	size_t DequeuedSize = 0;
+	uint32_t PixelFormat = 0;
+	size_t BytesPerLine = 0;
+	bool MonotonicTimestamps = false;
+	bool Streaming = false;
+	int DecodeFlags = cv::IMREAD_COLOR;
+
+	bool Ioctl(unsigned long Request, void* Arg, const char* RequestName) const;
+
+	bool SetControl(uint32_t Id, int Value);
+
+	bool QueueBuffer(int Index);
+
+	//Gives the held buffer back to the driver
+	void ReleaseDequeued();
+
+	void StopFeed();
+
+protected:
+	virtual bool ApplyControl(CameraControl Control, int Value) override;
+
+public:
+
+	V4L2Camera(std::shared_ptr<VideoCaptureCameraSettings> InSettings)
+		:Camera(InSettings)
+	{
+	}
+
+	~V4L2Camera();
+
+	//Start the camera
+	virtual bool StartFeed() override;
+
+	//Take the most recent frame the driver has, waiting for one if none is ready
+	virtual bool Grab() override;
+
+	//Decode the grabbed frame
+	virtual bool Read() override;
+};
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <filesystem>
 #include <opencv2/core.hpp>		// Basic OpenCV structures (Mat, Scalar)
 #include <opencv2/highgui.hpp>  // OpenCV window I/O
+#include <opencv2/imgcodecs.hpp>
 #include <opencv2/core/affine.hpp>
 
 
@@ -19,7 +21,22 @@ private:
 	//capture using classic api
 	std::unique_ptr<cv::VideoCapture> feed;
 	bool RealCamera;
-	int LastBrightness, LastGain;
+	//Monochrome real cameras : MJPEG is retrieved undecoded and decoded luma only, possibly downscaled
+	bool DecodeRaw = false;
+	int DecodeFlags = cv::IMREAD_GRAYSCALE;
+	cv::Mat RawFrame;
+	//Format of the last frame retrieved, so that the next one can be retrieved into a pooled buffer
+	cv::Size LastCaptureSize;
+	int LastCaptureType = CV_8UC3;
+	//Playback : when each frame of the file was recorded, in nanoseconds, and the index of the next frame to grab
+	std::vector<int64_t> RecordedTimes;
+	size_t PlaybackIndex = 0;
+
+	//From the timestamps.txt written next to the video while recording, or from the file's framerate
+	void LoadRecordedTimes(const std::filesystem::path &VideoPath);
+
+protected:
+	virtual bool ApplyControl(CameraControl Control, int Value) override;
 
 public:
 
@@ -30,7 +47,7 @@ public:
 
 	~VideoCaptureCamera()
 	{
-		
+		StopCaptureThread();
 	}
 
 	//Start the camera
@@ -43,4 +60,6 @@ public:
 	//Retrieve or read a frame
 	virtual bool Read() override;
 
+	virtual std::optional<int64_t> GetNextRecordedTime() const override;
+
 };
\ No newline at end of file
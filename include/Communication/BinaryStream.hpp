@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+//Wire format of the binary object stream pushed to SUBSCRIBE'd clients, see SpecJson.md
+//Everything is little-endian and packed, a frame is a header followed by Count records then Removed ids
+
+namespace BinaryStream
+{
+	//First byte is not printable so a frame can't be mistaken for a json line or a keep-alive space
+	constexpr uint8_t Magic[4] = {0xCB, 'C', 'Y', 'F'};
+	constexpr uint16_t Version = 1;
+
+	enum FrameFlags : uint16_t
+	{
+		Delta = 1<<0, //Only records that changed since the previous frame, plus removed ids
+		Millimeter = 1<<1 //x and y in table millimeters, r in degrees. Otherwise meters from the table center and radians
+	};
+
+#pragma pack(push, 1)
+	struct FrameHeader
+	{
+		uint8_t Magic[4];
+		uint32_t Length; //Bytes following this field
+		uint16_t Version;
+		uint16_t Flags;
+		uint64_t Sequence;
+		uint16_t Count;
+		uint16_t Removed;
+	};
+
+	struct ObjectRecord
+	{
+		uint16_t Type; //ObjectType
+		uint16_t Reserved;
+		uint32_t Id; //Hash of the object name
+		float X, Y, R;
+		uint32_t Age; //ms
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(FrameHeader) == 24);
+	static_assert(sizeof(ObjectRecord) == 24);
+
+	//FNV-1a, stable between runs so clients can keep their own name table
+	inline uint32_t HashName(std::string_view Name)
+	{
+		uint32_t hash = 2166136261u;
+		for (char c : Name)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <filesystem>
+
+#include <Communication/ProcessedTypes.hpp>
+#include <ArucoPipeline/ObjectIdentity.hpp>
+#include <Misc/BoundedQueue.hpp>
+
+//Binary log of what the runner solved each tick : the features of every camera and the objects that came out
+//Replaying it runs the tracker and the post processing again without any image, see CDFRExternal::ReplayEntryPoint
+//Layout : 4 bytes magic, u16 version, then for every tick a u32 length followed by that many bytes
+//Times are steady clock nanoseconds, as recorded. Images, depth maps and reprojected corners are not stored
+namespace FeatureLog
+{
+	constexpr char Extension[] = ".cylog";
+	constexpr uint8_t Magic[4] = {'C', 'Y', 'F', 'L'};
+	constexpr uint16_t Version = 1;
+
+	struct Tick
+	{
+		std::chrono::steady_clock::time_point Time;
+		CDFRTeam Team = CDFRTeam::Unknown;
+		std::vector<CameraFeatureData> Features;
+		std::vector<ObjectData> Objects;
+	};
+
+	//Serialises on the calling thread, the file is written on a separate one
+	class Writer
+	{
+	private:
+		std::ofstream File;
+		std::unique_ptr<BoundedQueue<std::vector<uint8_t>>> Queue;
+		std::unique_ptr<std::thread> Thread;
+
+		void ThreadEntryPoint();
+
+	public:
+		Writer() = default;
+		~Writer();
+
+		bool Open(std::filesystem::path Path);
+
+		bool IsOpen() const
+		{
+			return Thread != nullptr;
+		}
+
+		//Blocks only if the disk is far behind, ticks are never dropped
+		void Write(std::chrono::steady_clock::time_point Time, CDFRTeam Team, 
+			const std::vector<CameraFeatureData> &Features, const std::vector<ObjectData> &Objects);
+
+		void Close();
+	};
+
+	class Reader
+	{
+	private:
+		std::ifstream File;
+		std::vector<uint8_t> Buffer;
+
+	public:
+		bool Open(std::filesystem::path Path);
+
+		//False at the end of the log or on a truncated tick
+		bool Next(Tick &OutTick);
+	};
+}
@@ -4,11 +4,17 @@
 #include <thread>
 #include <vector>
 #include <set>
+#include <map>
 #include <chrono>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
 #include <opencv2/core/affine.hpp>
 #include <nlohmann/json.hpp>
 #include <ArucoPipeline/ObjectIdentity.hpp>
-#include <Transport/Task.hpp>
+#include <Misc/LineBuffer.hpp>
+#include <Communication/BinaryStream.hpp>
 
 //Get Cameras
 //Get image from camera #
@@ -23,10 +29,19 @@
 class TCPJsonHost;
 class ConnectionToken;
 
-class JsonListener : public Task
+//One client of the TCPJsonHost. Receiving, keep-alive and subscription pushes are polled by the host's reactor thread,
+//queries are queued and handled in order on the host's dispatch pool
+class JsonListener : public std::enable_shared_from_this<JsonListener>
 {
 private:
-	std::vector<char> ReceiveBuffer;
+	LineBuffer ReceiveBuffer;
+	std::atomic_bool killed = false;
+
+	std::mutex QueryMutex;
+	std::deque<std::string> PendingQueries;
+	bool Scheduled = false; //A dispatcher owns the pending queries
+
+	std::recursive_mutex SendMutex; //Sends come from both the reactor and the dispatchers, also protects Subscribed
 public:
 	std::shared_ptr<ConnectionToken> token = nullptr;
 	TCPJsonHost *Parent = nullptr;
@@ -42,7 +57,28 @@ public:
 			{TransformMode::Millimeter2D, "MILLIMETER_2D"},
 			{TransformMode::Float3D, "FLOAT_3D"}
 	};
-	TransformMode ObjectMode = TransformMode::Millimeter2D;
+	std::atomic<TransformMode> ObjectMode = TransformMode::Millimeter2D;
+
+	//Push mode : once subscribed, a binary frame is sent for every new external snapshot
+	struct Subscription
+	{
+		bool Active = false;
+		std::set<ObjectType> AllowedTypes;
+		ObjectData::Clock::duration MaxAge = ObjectData::Clock::duration::zero();
+		bool Delta = false;
+		int KeyframeInterval = 30; //Full frame every N frames when delta encoding, so late state can't drift forever
+		float PositionThreshold = 0.f; //In the units of the frame, a record is resent when it moved more than this
+		uint32_t AgeThreshold = 200; //ms, a record is resent when its age grew by more than this since it was last sent
+		uint64_t LastSequence = 0;
+		int FramesSinceKeyframe = 0;
+		struct SentObject
+		{
+			BinaryStream::ObjectRecord Record;
+			uint32_t NameHash; //Id before probing, shared by the objects with the same name
+		};
+		std::map<uint32_t, SentObject> LastSent;
+	};
+	Subscription Subscribed;
 
 
 	JsonListener(std::shared_ptr<ConnectionToken> InToken, class TCPJsonHost* InParent);
@@ -54,12 +90,22 @@ public:
 		return killed;
 	}
 
-private:
+	//Called by the reactor : receive, keep-alive and subscription. Returns true if anything happened
+	bool Poll();
 
-	static CDFRTeam StringToTeam(std::string team);
+	//Called by a dispatcher : handle the queued queries in order
+	void RunPendingQueries();
+
+	//Hands the pending queries to a dispatcher if none owns them yet
+	void SchedulePendingQueries();
 
+	//Object as sent in GetData, in the current ObjectMode. nullopt if its type isn't sent
 	std::optional<nlohmann::json> ObjectToJson(const struct ObjectData& Object);
 
+private:
+
+	static CDFRTeam StringToTeam(std::string team);
+
 	static std::string JavaCapitalize(std::string source);
 
 	std::set<ObjectType> GetFilterClasses(const nlohmann::json &filter);
@@ -87,7 +133,13 @@ private:
 
 	void SendJson(const nlohmann::json &object);
 
-	void CheckAlive();
+	bool Subscribe(const nlohmann::json &Query, nlohmann::json &Response);
+
+	//Id of an object in the push frames, stable from one frame to the next when possible
+	uint32_t GetSubscriptionId(uint32_t NameHash, const BinaryStream::ObjectRecord &Record, const std::map<uint32_t, Subscription::SentObject> &Current) const;
 
-	virtual void ThreadEntryPoint() override;
+	//Sends a binary frame if the external runner has a newer snapshot than the last one sent
+	bool PushSubscription();
+
+	void CheckAlive();
 };
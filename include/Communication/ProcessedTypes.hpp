@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <chrono>
 #include <opencv2/core.hpp>
 #include <opencv2/core/affine.hpp>
 #include <ArucoPipeline/ArucoTypes.hpp>
@@ -55,6 +56,7 @@ struct CameraFeatureData
 
 	cv::Affine3d WorldToCamera; 	//Filled by CopyEssentials from CameraImageData, World to camera
 	cv::Size FrameSize; 			//Filled by CopyEssentials from CameraImageData
+	std::chrono::steady_clock::time_point GrabTime; //Filled by CopyEssentials from CameraImageData, when the frame was captured
 
 	std::vector<LensFeatureData> Lenses;
 
@@ -2,18 +2,36 @@
 
 #include <memory>
 #include <set>
+#include <vector>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <optional>
 #include <Transport/GenericTransport.hpp>
+#include <Misc/BoundedQueue.hpp>
 
+class JsonListener;
+
+//Accepts json clients. A single reactor thread per interface polls every client, 
+//and the queries they send are handled on a small pool of dispatch threads
 class TCPJsonHost
 {
 private:
 	std::set<std::unique_ptr<std::thread>> ThreadHandles;
+	std::vector<std::unique_ptr<std::thread>> Dispatchers;
+	BoundedQueue<std::shared_ptr<JsonListener>> ScheduledListeners;
 	int Port;
-	bool killed;
+	std::atomic_bool killed = false;
 	std::atomic<int> NumClients = 0;
+
+	static constexpr int NumDispatchers = 2;
+	static constexpr std::chrono::milliseconds AcceptInterval{100};
+	//When nothing happens the reactor waits longer each time, or until the next accept when there is no client
+	//The transport gives no descriptor to wait on, so this bounds how late a query is seen. Clients usually query right after new data, 
+	//so a new snapshot wakes the reactor up and starts again from MinIdleWait
+	//The wait stays under ActiveIdleWait, and only grows to QuietIdleWait once no client did anything for QuietAfter
+	static constexpr std::chrono::microseconds MinIdleWait{250}, ActiveIdleWait{500}, QuietIdleWait{20000};
+	static constexpr std::chrono::seconds QuietAfter{1};
 public:
 	class CDFRExternal* ExternalRunner = nullptr;
 	class CDFRInternal* InternalRunner = nullptr;
@@ -25,6 +43,12 @@ public:
 		return killed;
 	}
 
+	//Called by a listener that received queries, they will be handled by a dispatcher
+	//Never blocks : returns false if the dispatchers are too far behind, the listener retries on its next poll
+	bool ScheduleQueries(std::shared_ptr<JsonListener> Listener);
+
 private:
 	void ThreadEntryPoint(std::optional<GenericTransport::NetworkInterface> interface);
-};
\ No newline at end of file
+
+	void DispatchEntryPoint();
+};
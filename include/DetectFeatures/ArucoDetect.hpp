@@ -5,6 +5,22 @@
 #include <opencv2/core.hpp>
 #include <filesystem>
 
+//Where the tags of a camera were last seen, used by the tracked detection to only search around them
+//One per camera, must only be used by the thread processing that camera
+struct ArucoTrackingState
+{
+	std::vector<std::vector<cv::Rect>> LastROIs; //per lens, relative to the lens ROI
+	int FramesSinceSweep = 0;
+	int LastNumDetections = 0;
+	bool ForceSweep = false; //a tag was lost on a partial frame, sweep on the next one
+
+	//Will the next call to DetectArucoTracked search the whole frame ?
+	bool SweepDue(size_t NumLenses, int FullSweepInterval) const
+	{
+		return ForceSweep || LastROIs.size() != NumLenses || FramesSinceSweep >= FullSweepInterval;
+	}
+};
+
 cv::UMat PreprocessArucoImage(cv::UMat Source);
 
 std::vector<cv::Rect> GetPOIRects(const std::vector<std::vector<cv::Point3d>> &POIs, cv::Size framesize, 
@@ -14,6 +30,11 @@ int DetectAruco(CameraImageData InData, CameraFeatureData *OutData);
 
 int DetectArucoSegmented(CameraImageData InData, CameraFeatureData *OutData, int MaxArucoSize, cv::Size Segments);
 
+//Search for tags only around where they were seen last frame
+//Falls back to DetectArucoSegmented every FullSweepInterval frames, or as soon as a tag is lost
+//If the image is only valid in some places (InData.ValidROIs), the sweep for a lost tag is delayed to the next frame
+int DetectArucoTracked(CameraImageData InData, CameraFeatureData *OutData, ArucoTrackingState &State, int MaxArucoSize, cv::Size Segments, int FullSweepInterval);
+
 int DetectArucoPOI(CameraImageData InData, CameraFeatureData *OutData, const std::vector<std::vector<cv::Point3d>> &POIs);
 
 void PolyCameraArucoMerge(CameraFeatureData &InOutData);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <opencv2/core.hpp>
+#include <opencv2/core/affine.hpp>
+
+struct CameraImageData;
+
+//Picks the segment grid of the full frame aruco sweep of one camera by timing the sweeps
+//Starts from the fixed heuristic, then moves to whichever neighbouring grid (a column or a row more or less) sweeps fastest,
+//and probes the neighbours again once in a while as the load of the machine and the scene change
+//The overlap between segments is the largest a tag can look from where the camera is, instead of a constant
+//One per camera, must only be used by the thread processing that camera
+class ArucoGridTuner
+{
+public:
+	//Used while the camera has no location
+	static constexpr int DefaultOverlap = 200;
+	static constexpr int MinOverlap = 32;
+
+	//Sweeps timed on a grid before it is compared to others
+	int SamplesPerGrid = 4;
+	//Sweeps done on the best grid before one of its neighbours is tried again
+	int ProbeInterval = 100;
+	//Tags are never higher than this above the table (top of the robots)
+	double MaxTagHeight = 0.5;
+	//Grids with more segments than this times the number of cores are not tried
+	int MaxSegmentsPerCore = 4;
+	//Fraction by which a neighbour must be faster to be moved to
+	double Hysteresis = 0.05;
+
+private:
+	struct GridTiming
+	{
+		double Mean = 0; //s, running mean where the newer sweeps weigh more
+		int Samples = 0;
+	};
+
+	cv::Size LensSize;
+	cv::Size Current, Best;
+	int Overlap = 0;
+	int SweepsOnBest = 0;
+	size_t NextProbe = 0;
+	std::map<std::pair<int, int>, GridTiming> Timings;
+
+	void Reset(cv::Size InLensSize);
+
+	std::vector<cv::Size> GetNeighbours(cv::Size Grid) const;
+
+	const GridTiming* GetTiming(cv::Size Grid) const;
+
+	//A neighbour of Grid that hasn't been timed enough yet
+	std::optional<cv::Size> GetUnexplored(cv::Size Grid) const;
+
+	//Grid, or the neighbour that is faster than it by more than Hysteresis
+	cv::Size GetFastest(cv::Size Grid) const;
+
+public:
+	//The fixed heuristic : a segment per 800 pixels, no more than there are cores
+	static cv::Size GetDefaultGrid(cv::Size LensSize);
+
+	//Pixel size of the largest tag seen from as close as it can get, DefaultOverlap if the camera has no height yet
+	int ComputeOverlap(const CameraImageData &ImageData, cv::Affine3d Location, double LargestTag) const;
+
+	//To call before the sweep, picks up a change of resolution or of camera location
+	void Prepare(const CameraImageData &ImageData, cv::Affine3d Location, double LargestTag);
+
+	cv::Size GetGrid() const
+	{
+		return Current;
+	}
+
+	int GetOverlap() const
+	{
+		return Overlap;
+	}
+
+	//Wall clock time of a full sweep done with GetGrid and GetOverlap
+	void AddSweep(double Seconds);
+};
@@ -10,26 +10,36 @@
 
 class YoloDetect
 {
-private:
+public:
 	struct Detection
 	{
-		cv::Rect BoundingBox;
+		cv::Rect2f BoundingBox;
 		float Confidence;
-		std::vector<float> Classes;
-
-		Detection(const cv::Rect &InBoundingBox, float InConfidence, const std::vector<float> &InClasses)
-			:BoundingBox(InBoundingBox), Confidence(InConfidence), Classes(InClasses)
-		{}
+		int Class;
+	};
+	//How a lens image was fit in the network input : input = lens * Scale + Offset
+	struct Letterbox
+	{
+		double Scale;
+		cv::Point2d Offset;
 	};
+private:
 	std::string ModelName;
 	std::vector<std::string> ClassNames;
 	cv::dnn::Net network;
+	bool NetworkLoaded = false;
+	bool NormalizedOutput = false; //Darknet outputs boxes relative to the input size, ONNX exports in input pixels
+	std::vector<cv::Mat> LetterboxBuffers; //reused between batches
 	std::filesystem::path GetNetworkPath(std::string extension = "") const;
 	void loadNames();
 	void loadNet();
-	void Preprocess(const cv::UMat& frame, cv::Size inpSize, float scale, const cv::Scalar& mean, bool swapRB);
-	std::vector<Detection> Postprocess(const std::vector<cv::Mat> &outputBlobs, const std::vector<std::string> &layerNames, cv::Rect window);
+	Letterbox Preprocess(const cv::UMat& frame, cv::Size inpSize, cv::Mat &Letterboxed);
 public:
+	//Decodes the network outputs into detections in input pixels, one list per letterboxed lens
+	//NormalizedOutput is true for Darknet networks, whose boxes are relative to the input size
+	static std::vector<std::vector<Detection>> Postprocess(const std::vector<cv::Mat> &outputBlobs, const std::vector<Letterbox> &Letterboxes, 
+		cv::Size inpSize, int numclasses, bool NormalizedOutput);
+
 	YoloDetect(std::string inModelName = "cdfr", int inNumclasses = 4);
 	virtual ~YoloDetect();
 	
@@ -37,6 +47,14 @@ public:
 
 	int GetNumClasses() const;
 
+	bool IsLoaded() const
+	{
+		return NetworkLoaded;
+	}
+
+	//Runs every lens of every valid image through a single forward pass. Detections are given relative to the lens ROI
+	int DetectBatch(const std::vector<CameraImageData> &InData, const std::vector<CameraFeatureData*> &OutData);
+
 	int Detect(CameraImageData InData, CameraFeatureData *OutData);
 
 	std::vector<ObjectData> Project(const CameraImageData &ImageData, const CameraFeatureData& FeatureData);
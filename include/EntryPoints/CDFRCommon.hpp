@@ -18,6 +18,7 @@
 
 #include <Misc/FrameCounter.hpp>
 #include <Misc/ManualProfiler.hpp>
+#include <Misc/LatencyStats.hpp>
 
 
 using namespace cv;
@@ -35,16 +36,23 @@ namespace CDFRCommon
 
 		bool ArucoDetection = true;
 		bool SegmentedDetection = true;
+		bool TrackedDetection = true;
+		int FullSweepInterval = 10;
+		bool TuneSegments = true; //time the full sweeps and pick the segment grid of each camera from them
 		bool POIDetection = false;
 		bool YoloDetection = false;
 		bool DepthMapping = false;
 		bool Denoising = false;
 		bool DistortedDetection = true;
+		bool UndistortROIsOnly = false; //with tracked detection, only undistort around the tags between two sweeps
 		bool SolveCameraLocation = true;
+		bool AutoExposure = false; //brightness and gain driven by the contrast of the tags seen
+		bool LogFeatures = false; //write the features and objects of every tick to a replayable log
 
 		Settings(bool External)
 			:direct(External),
 			SegmentedDetection(External),
+			TrackedDetection(External),
 			DistortedDetection(External),
 			SolveCameraLocation(External)
 		{
@@ -57,9 +65,11 @@ namespace CDFRCommon
 
 	void MakeTrackedObjects(bool Internal, std::map<CDFRTeam, ObjectTracker&> Trackers);
 
+	//Latency gets the time spent detecting the tags and solving the camera location, if given
+	//Only reads the tracker through its snapshot, so it can run while the tracker is being solved
 	bool ImageToFeatureData(const CDFRCommon::Settings &Settings,  
 		Camera* cam, const CameraImageData& ImData, CameraFeatureData& FeatData, 
-		ObjectTracker& Tracker, std::chrono::steady_clock::time_point GrabTick, YoloDetect *YoloDetector = nullptr);
+		const TrackerSnapshot& Tracker, std::chrono::steady_clock::time_point GrabTick, LatencyStats* Latency = nullptr);
 };
 
 string TimeToStr();
\ No newline at end of file
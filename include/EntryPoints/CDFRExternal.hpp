@@ -2,18 +2,53 @@
 
 #include <thread>
 #include <vector>
-#include <array>
+#include <map>
 #include <memory>
 #include <filesystem>
 #include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
 
 #include <Communication/ProcessedTypes.hpp>
 #include <ArucoPipeline/ObjectIdentity.hpp>
 #include <ArucoPipeline/ObjectTracker.hpp>
 #include <Cameras/ImageTypes.hpp>
 #include <Misc/FrameCounter.hpp>
+#include <Misc/LatencyStats.hpp>
 #include <Transport/Task.hpp>
 #include <PostProcessing/PostProcess.hpp>
+#include <EntryPoints/CameraWorker.hpp>
+#include <Communication/FeatureLog.hpp>
+#include <EntryPoints/Regression.hpp>
+
+//Result of one detection tick. Published once complete and never modified afterwards,
+//so readers can keep it as long as they want without copying or locking
+struct ExternalSnapshot
+{
+	uint64_t Sequence = 0;
+	std::vector<CameraImageData> ImageData;
+	std::vector<CameraFeatureData> FeatureData;
+	std::vector<ObjectData> ObjData;
+};
+
+//Headless run of a simulation scenario for a fixed number of ticks, reporting the latency of each stage
+struct ExternalBenchmark
+{
+	//Scenario file, relative to the sim folder if it doesn't exist as given
+	std::filesystem::path Scenario;
+	int Ticks = 1000;
+	//The json report is written there, or to stdout if empty
+	std::filesystem::path Output;
+	//Regression : the objects of every tick are compared to this trajectory, or written to it if RecordGolden is set
+	//The scenario is then replayed as fast as possible and the run lasts as long as the trajectory
+	std::filesystem::path Golden;
+	bool RecordGolden = false;
+	//Tick time p95 budget in ms, overrides the one stored in the trajectory if not 0
+	double TickBudget = 0;
+};
 
 class CDFRExternal : public Task
 {
@@ -37,12 +72,21 @@ private:
 	std::filesystem::path RecordRootPath;
 
 	std::unique_ptr<class YoloDetect> YoloDetector;
+	std::unique_ptr<class YoloLane> YoloInference;
 
 	//Camera manager
 	std::unique_ptr<class CameraManager> CameraMan;
 
 	std::vector<std::unique_ptr<PostProcess>> PostProcesses;
 
+	//Features and objects of every tick, while ExternalSettings.LogFeatures is set
+	std::unique_ptr<FeatureLog::Writer> FeatureLogger;
+	//If set, the cameras are not started and this log is replayed through the trackers and the post processing
+	std::filesystem::path ReplayPath;
+	//If set, the scenario is run without visualizers then the runner stops and reports
+	std::optional<ExternalBenchmark> Bench;
+	std::atomic_bool BenchmarkFailed = false;
+
 protected:
 	//3D viz
 	std::unique_ptr<class ExternalBoardGL> OpenGLBoard;
@@ -52,15 +96,36 @@ protected:
 
 private:
 	//data
-	int BufferIndex = 0;
 	CDFRTeam LastTeam = CDFRTeam::Unknown, LockedTeam = CDFRTeam::Unknown;
 	ObjectTracker BlueTracker, YellowTracker, UnknownTracker;
-	std::array<std::vector<CameraImageData>, 3> ImageData;
-	std::array<std::vector<CameraFeatureData>, 3> FeatureData;
-	std::array<std::vector<ObjectData>, 3> ObjData;
+	//Only accessed through atomic_load/atomic_store
+	std::shared_ptr<const ExternalSnapshot> LatestSnapshot = std::make_shared<const ExternalSnapshot>();
+	std::atomic<uint64_t> SnapshotSequence = 0;
+	mutable std::mutex SnapshotMutex;
+	mutable std::condition_variable SnapshotPublished;
+
+	//One worker per registered camera, created and destroyed by the camera manager callbacks
+	std::map<class Camera*, std::unique_ptr<CameraWorker>> Workers;
+	//Cameras that were asked for a frame last tick, in the order their results will be collected
+	std::vector<class Camera*> InFlightCameras;
+	ObjectTracker* InFlightTracker = &UnknownTracker;
+	std::chrono::steady_clock::time_point InFlightGrabTick;
 
 	CDFRTeam GetTeamFromCameraPosition(std::vector<class Camera*> Cameras);
 
+	ObjectTracker& GetTracker(CDFRTeam Team);
+
+	//Makes the snapshot visible to GetSnapshot and wakes WaitForSnapshot
+	void Publish(std::shared_ptr<ExternalSnapshot> Snapshot);
+
+	//Runs the recorded ticks of ReplayPath as fast as possible, then stops the runner
+	void ReplayEntryPoint(ExternalProfType &prof);
+
+	void WriteBenchmarkReport(const LatencyStats &Latency, size_t Ticks, size_t Frames, std::chrono::duration<double> Duration) const;
+
+	//Compares to the golden trajectory, or records it. Returns false if the run drifted or went over budget
+	bool CheckRegression(const LatencyStats &Latency, const Regression::Trajectory &Golden, Regression::Trajectory &Actual) const;
+
 	void UpdateDirectImage(const std::vector<class Camera*> &Cameras, const std::vector<CameraFeatureData> &FeatureDataLocal);
 
 protected:
@@ -101,15 +166,25 @@ public:
 
 	virtual void ThreadEntryPoint() override;
 
-	int GetReadBufferIndex() const;
+	//Only meaningful once a benchmark run is killed
+	bool HasBenchmarkFailed() const
+	{
+		return BenchmarkFailed;
+	}
 
-	std::vector<CameraImageData> GetImage() const;
+	//Latest completed tick, never null. Safe to call from any thread
+	std::shared_ptr<const ExternalSnapshot> GetSnapshot() const;
 
-	std::vector<CameraFeatureData> GetFeatureData() const;
+	//Sequence of the latest completed tick, cheap way to know if GetSnapshot has something new
+	uint64_t GetSnapshotSequence() const
+	{
+		return SnapshotSequence.load();
+	}
 
-	std::vector<ObjectData> GetObjectData() const;
+	//Blocks until a snapshot newer than Sequence is published or the timeout expires. Returns true if there is a newer one
+	bool WaitForSnapshot(uint64_t Sequence, std::chrono::microseconds Timeout) const;
 
-	CDFRExternal();
+	CDFRExternal(std::filesystem::path InReplayPath = std::filesystem::path(), std::optional<ExternalBenchmark> InBench = std::nullopt);
 	virtual ~CDFRExternal();
 
 	friend class ExternalImgui;
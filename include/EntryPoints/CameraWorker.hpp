@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <filesystem>
+
+#include <Cameras/ImageTypes.hpp>
+#include <Communication/ProcessedTypes.hpp>
+#include <Misc/BoundedQueue.hpp>
+#include <Misc/ManualProfiler.hpp>
+#include <Misc/LatencyStats.hpp>
+
+class Camera;
+struct TrackerSnapshot;
+
+using ExternalProfType = ManualProfiler<false>;
+
+//Persistent thread that runs the per-camera part of the external pipeline : grab, read, undistort and feature detection
+//With continuous capture, grab and read run on the camera's capture thread and the worker takes the latest frame
+//The runner requests a frame with a Job and collects it later, so the next frame can be processed while the runner solves the previous one
+//Only one job is in flight at a time, the result queue is bounded to a single element
+class CameraWorker
+{
+public:
+	struct Job
+	{
+		//Copy taken when the job is dispatched, the tracker itself is solved and modified by the runner meanwhile
+		std::shared_ptr<const TrackerSnapshot> Tracker;
+		std::chrono::steady_clock::time_point GrabTick;
+		bool Record = false;
+		std::filesystem::path RecordPath;
+		int RecordIndex = 0;
+		//Fill the result's Latency with the time taken by each stage
+		bool MeasureLatency = false;
+	};
+
+	struct Result
+	{
+		CameraImageData ImageData;
+		CameraFeatureData FeatureData;
+		ExternalProfType Profiler;
+		LatencyStats Latency;
+	};
+
+private:
+	std::shared_ptr<Camera> Cam;
+	BoundedQueue<Job> Jobs;
+	BoundedQueue<Result> Results;
+	std::unique_ptr<std::thread> Thread;
+	std::atomic_bool killed = false;
+	bool InFlight = false; //Only touched by the runner
+
+	void ThreadEntryPoint();
+
+public:
+	CameraWorker(std::shared_ptr<Camera> InCam);
+	~CameraWorker();
+
+	Camera* GetCamera() const
+	{
+		return Cam.get();
+	}
+
+	bool IsInFlight() const
+	{
+		return InFlight;
+	}
+
+	//Ask for the next frame to be processed. Returns false if a frame is already being processed
+	bool Request(Job InJob);
+
+	//Wait for the frame asked by Request. Returns nullopt on timeout, in which case the job stays in flight
+	std::optional<Result> Collect(std::chrono::milliseconds Timeout);
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <opencv2/core.hpp>
+
+#include <ArucoPipeline/ObjectIdentity.hpp>
+
+//Golden trajectories : the objects solved on every tick of a scenario replay, stored next to the scenario as <scenario>.golden.json
+//A replay of the same scenario is deterministic, so a later run must find the same objects at the same places, within tolerances
+namespace Regression
+{
+	struct ObjectPose
+	{
+		std::string Name;
+		ObjectType Type;
+		cv::Vec3d Position;
+		double Rotation; //around Z, radians
+	};
+
+	struct Trajectory
+	{
+		double PositionTolerance = 0.02; //m
+		double RotationTolerance = 0.05; //rad
+		//p95 of the tick time the run must stay under, in ms. 0 to not check
+		double TickBudget = 0;
+		//Objects of every tick that had frames, warmup included
+		std::vector<std::vector<ObjectPose>> Ticks;
+	};
+
+	std::filesystem::path GetGoldenPath(std::filesystem::path Scenario);
+
+	//All the recordings the scenario points to are there, they are not part of the repository
+	bool HasScenarioMedia(std::filesystem::path Scenario);
+
+	std::vector<ObjectPose> ToPoses(const std::vector<ObjectData> &Objects);
+
+	bool Load(std::filesystem::path Path, Trajectory &Out);
+
+	bool Save(std::filesystem::path Path, const Trajectory &In);
+
+	//Objects are matched one to one by name and type, closest first
+	//Prints every difference, returns the number of objects that moved too far, went missing or were not expected
+	size_t Compare(const Trajectory &Golden, const Trajectory &Actual);
+}
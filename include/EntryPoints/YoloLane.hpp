@@ -0,0 +1,66 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+
+#include <Cameras/ImageTypes.hpp>
+#include <Communication/ProcessedTypes.hpp>
+#include <ArucoPipeline/ObjectIdentity.hpp>
+
+class YoloDetect;
+
+//Runs YOLO on its own thread so that the aruco pipeline never waits for the network
+//Only the newest frame of each camera is kept : frames submitted while the network is busy replace the older ones
+class YoloLane
+{
+public:
+	struct Result
+	{
+		uint64_t Sequence = 0;
+		//Grab time of the oldest frame used
+		std::chrono::steady_clock::time_point GrabTime;
+		//Per camera name, detections for each lens, relative to the lens ROI
+		std::map<std::string, std::vector<std::vector<YoloDetection>>> Detections;
+		//Projected detections, LastSeen is the grab time of their frame
+		std::vector<ObjectData> Objects;
+	};
+
+private:
+	YoloDetect* Detector;
+	struct PendingFrame
+	{
+		CameraImageData Image;
+		CameraFeatureData Features; //only calibration and camera location, enough to project
+	};
+	std::map<std::string, PendingFrame> Pending;
+	std::mutex PendingMutex;
+	std::condition_variable PendingCondition;
+	std::shared_ptr<const Result> Latest = std::make_shared<const Result>(); //Only accessed through atomic_load/atomic_store
+	std::atomic<uint64_t> Dropped = 0;
+	std::atomic_bool killed = false;
+	std::unique_ptr<std::thread> Thread;
+
+	void ThreadEntryPoint();
+
+public:
+	YoloLane(YoloDetect* InDetector);
+	~YoloLane();
+
+	//Hand the frames of a tick over to the lane, never blocks
+	void Submit(const std::vector<CameraImageData> &Images, const std::vector<CameraFeatureData> &Features);
+
+	//Newest finished inference, never null
+	std::shared_ptr<const Result> GetLatest() const;
+
+	//Number of frames that were replaced before the network could process them
+	uint64_t GetDroppedFrames() const
+	{
+		return Dropped.load();
+	}
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include <condition_variable>
+
+//Thread-safe FIFO with a fixed capacity, used to hand data between threads without letting one side run away
+//Push blocks when full, TryPush refuses, PushDropOldest makes room by discarding the oldest element
+template<class T>
+class BoundedQueue
+{
+private:
+	std::deque<T> Items;
+	size_t Capacity;
+	bool Closed = false;
+	mutable std::mutex Mutex;
+	std::condition_variable NotEmpty, NotFull;
+public:
+	BoundedQueue(size_t InCapacity = 1)
+		:Capacity(InCapacity)
+	{}
+
+	//Blocks until there is room. Returns false if the queue was closed
+	bool Push(T Item)
+	{
+		std::unique_lock lock(Mutex);
+		NotFull.wait(lock, [this](){return Closed || Items.size() < Capacity;});
+		if (Closed)
+		{
+			return false;
+		}
+		Items.push_back(std::move(Item));
+		NotEmpty.notify_one();
+		return true;
+	}
+
+	//Returns false if the queue is full or closed
+	bool TryPush(T Item)
+	{
+		std::unique_lock lock(Mutex);
+		if (Closed || Items.size() >= Capacity)
+		{
+			return false;
+		}
+		Items.push_back(std::move(Item));
+		NotEmpty.notify_one();
+		return true;
+	}
+
+	//Never blocks, returns the number of elements that were dropped to make room
+	size_t PushDropOldest(T Item)
+	{
+		std::unique_lock lock(Mutex);
+		if (Closed)
+		{
+			return 1;
+		}
+		size_t dropped = 0;
+		while (Items.size() >= Capacity && Items.size() > 0)
+		{
+			Items.pop_front();
+			dropped++;
+		}
+		Items.push_back(std::move(Item));
+		NotEmpty.notify_one();
+		return dropped;
+	}
+
+	//Blocks until an element is available or the queue is closed
+	std::optional<T> Pop()
+	{
+		std::unique_lock lock(Mutex);
+		NotEmpty.wait(lock, [this](){return Closed || Items.size() > 0;});
+		return PopLocked();
+	}
+
+	//Blocks until an element is available, the timeout expires or the queue is closed
+	template<class Rep, class Period>
+	std::optional<T> Pop(std::chrono::duration<Rep, Period> Timeout)
+	{
+		std::unique_lock lock(Mutex);
+		NotEmpty.wait_for(lock, Timeout, [this](){return Closed || Items.size() > 0;});
+		return PopLocked();
+	}
+
+	std::optional<T> TryPop()
+	{
+		std::unique_lock lock(Mutex);
+		return PopLocked();
+	}
+
+	//Wakes up every waiter, further pushes are refused. Elements already queued can still be popped
+	void Close()
+	{
+		std::unique_lock lock(Mutex);
+		Closed = true;
+		NotEmpty.notify_all();
+		NotFull.notify_all();
+	}
+
+	void Clear()
+	{
+		std::unique_lock lock(Mutex);
+		Items.clear();
+		NotFull.notify_all();
+	}
+
+	size_t Size() const
+	{
+		std::unique_lock lock(Mutex);
+		return Items.size();
+	}
+
+	bool IsClosed() const
+	{
+		std::unique_lock lock(Mutex);
+		return Closed;
+	}
+
+private:
+	std::optional<T> PopLocked()
+	{
+		if (Items.size() == 0)
+		{
+			return std::nullopt;
+		}
+		std::optional<T> Item(std::move(Items.front()));
+		Items.pop_front();
+		NotFull.notify_one();
+		return Item;
+	}
+};
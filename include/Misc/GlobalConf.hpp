@@ -14,10 +14,15 @@ struct CaptureConfig
 {
 	int StartType; //See CameraStartType in Misc/ImageTypes.hpp . Chooses method to use to start the camera
 	float ReductionFactor; //factor to downscale image before aruco detection
+	int DecodeReduction; //1, 2, 4 or 8 : downscale done while decoding MJPEG, only for monochrome cameras. Unlike ReductionFactor the full resolution frame is never available
 	int CaptureFramerate;
 	int FramerateDivider;
 	std::string filter; //filter to block or allow certain cameras. If camera name contains the filter string, it's allowed. If the filter string starts with a !, the filter is inverted
 	int Brightness, Gain;
+	bool CompactUndistortMaps; //convert undistortion maps to fixed point, faster to remap but with 1/32 pixel interpolation steps. Off by default
+	int V4L2Buffers; //number of mmap'd buffers in the driver ring, only for the V4L2 start type
+	bool ContinuousCapture; //each camera reads frames on its own thread and the pipeline only takes the latest one. Not used for playback
+	bool RecordRaw; //record to a lossless .cyraw file (MJPEG passthrough when available) instead of x264
 };
 
 extern bool RecordVideo;
@@ -26,6 +31,9 @@ std::filesystem::path GetAssetsPath();
 
 std::string GetScenario();
 
+//Replay the scenario at the speed it was recorded, otherwise as fast as possible
+bool GetScenarioRealTime();
+
 bool GetIdleOnStart();
 
 bool DoScreenCapture();
@@ -41,6 +49,12 @@ CameraStartType GetCaptureMethod();
 //list of downscales to be done to the aruco detections
 float GetReductionFactor();
 
+//Only for tools and benchmarks : detectors that were already created keep the corner refinement of the previous factor
+void SetReductionFactor(float Factor);
+
+//Downscale done by the jpeg decoder, always 1, 2, 4 or 8
+int GetDecodeReduction();
+
 int& GetBrightness();
 
 int& GetGain();
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <nlohmann/json.hpp>
+
+//Latency samples of named stages, to get percentiles instead of averages
+//Every sample is kept so the percentiles are exact, a benchmark run is a few thousand ticks
+class LatencyStats
+{
+private:
+	std::map<std::string, std::vector<double>> Samples; //seconds
+public:
+	void Add(const std::string &Stage, std::chrono::duration<double> Duration)
+	{
+		Samples[Stage].push_back(Duration.count());
+	}
+
+	void operator+=(const LatencyStats &other);
+
+	bool Empty() const
+	{
+		return Samples.empty();
+	}
+
+	void Clear()
+	{
+		Samples.clear();
+	}
+
+	//Nearest rank percentile of a stage in seconds, 0 if it has no samples
+	double GetPercentile(const std::string &Stage, double Percentile) const;
+
+	//Per stage : count, mean, p50, p95, p99 and max, in milliseconds
+	nlohmann::json ToJson() const;
+};
+
+//Times consecutive stages of a thread into a LatencyStats, does nothing without one
+class StageTimer
+{
+	typedef std::chrono::steady_clock latencyclock;
+private:
+	LatencyStats* Stats;
+	latencyclock::time_point LastLap;
+public:
+	StageTimer(LatencyStats* InStats)
+		:Stats(InStats)
+	{
+		Restart();
+	}
+
+	//Time since the last lap or restart goes to Stage
+	void Lap(const std::string &Stage)
+	{
+		if (!Stats)
+		{
+			return;
+		}
+		auto now = latencyclock::now();
+		Stats->Add(Stage, now - LastLap);
+		LastLap = now;
+	}
+
+	//Don't count the time since the last lap
+	void Restart()
+	{
+		if (Stats)
+		{
+			LastLap = latencyclock::now();
+		}
+	}
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <optional>
+#include <string_view>
+
+//Receive buffer that splits incoming bytes on '\n' without copying them
+//Consumed bytes are only moved back when the tail runs out of space, instead of erasing the front after every line
+class LineBuffer
+{
+private:
+	std::vector<char> Buffer;
+	size_t Begin = 0, End = 0, Scanned = 0;
+public:
+	LineBuffer(size_t Capacity = 1<<16)
+		:Buffer(Capacity)
+	{}
+
+	//Where the next received bytes should go, call Commit with the amount actually written
+	//Empty if a single line fills the whole buffer
+	std::pair<char*, size_t> GetWriteArea()
+	{
+		if (Begin > 0 && Buffer.size() - End < Buffer.size()/4)
+		{
+			Compact();
+		}
+		return {Buffer.data() + End, Buffer.size() - End};
+	}
+
+	void Commit(size_t NumWritten)
+	{
+		End += NumWritten;
+	}
+
+	//Next complete line, without the '\n'. The view is valid until the next GetWriteArea
+	std::optional<std::string_view> NextLine()
+	{
+		for (; Scanned < End; Scanned++)
+		{
+			if (Buffer[Scanned] != '\n')
+			{
+				continue;
+			}
+			std::string_view line(Buffer.data() + Begin, Scanned - Begin);
+			Scanned++;
+			Begin = Scanned;
+			return line;
+		}
+		if (Begin == End)
+		{
+			Begin = End = Scanned = 0;
+		}
+		return std::nullopt;
+	}
+
+	void Clear()
+	{
+		Begin = End = Scanned = 0;
+	}
+
+private:
+	void Compact()
+	{
+		std::memmove(Buffer.data(), Buffer.data() + Begin, End - Begin);
+		End -= Begin;
+		Scanned -= Begin;
+		Begin = 0;
+	}
+};
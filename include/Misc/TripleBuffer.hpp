@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+//Lock-free single producer, single consumer "latest value" slot
+//The writer fills the back slot and swaps it with the middle one, the reader swaps the middle one with its front slot
+//The reader always gets the most recent value, values published in between are overwritten
+template<class T>
+class TripleBuffer
+{
+private:
+	static constexpr uint8_t IndexMask = 0x3;
+	static constexpr uint8_t NewBit = 0x4; //Set when the middle slot holds a value the reader hasn't taken
+
+	std::array<T, 3> Slots;
+	std::atomic<uint8_t> Middle = 1;
+	uint8_t Back = 0; //Only touched by the writer
+	uint8_t Front = 2; //Only touched by the reader
+
+public:
+	//Writer : the slot to fill before calling Publish
+	T& GetBack()
+	{
+		return Slots[Back];
+	}
+
+	//Writer : makes the back slot visible to the reader. Returns true if the previous value was never taken
+	bool Publish()
+	{
+		uint8_t previous = Middle.exchange(Back | NewBit, std::memory_order_acq_rel);
+		Back = previous & IndexMask;
+		return (previous & NewBit) != 0;
+	}
+
+	bool HasNew() const
+	{
+		return (Middle.load(std::memory_order_acquire) & NewBit) != 0;
+	}
+
+	//Reader : takes the most recent value, nullptr if nothing was published since the last call
+	//The value stays valid until the next call
+	T* Take()
+	{
+		if (!HasNew())
+		{
+			return nullptr;
+		}
+		uint8_t previous = Middle.exchange(Front, std::memory_order_acq_rel);
+		Front = previous & IndexMask;
+		return &Slots[Front];
+	}
+};
@@ -5,4 +5,7 @@ std::filesystem::path GetExecutablePath();
 std::filesystem::path GetCyclopsPath();
 std::filesystem::path GetScreenCapturePath();
 
+//Scenario file as given if it exists, otherwise relative to the sim folder
+std::filesystem::path GetScenarioPath(std::filesystem::path Scenario);
+
 void SetExecutablePath(const char* path);
\ No newline at end of file
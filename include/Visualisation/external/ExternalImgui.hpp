@@ -13,6 +13,10 @@ private:
 	bool ShowAruco = true, ShowYolo = true;
 	bool FocusPeeking = false;
 	std::vector<cv::UMatData*> LastMatrices;
+	//frame buffers are pooled, so the same UMatData comes back with new content : also check the snapshot
+	uint64_t LastTexturesSequence = 0;
+	uint64_t LastAllocationCount = 0, LastAllocationSequence = 0;
+	double AllocationsPerFrame = 0;
 public:
 
 	ExternalImgui(std::string InWindowName = "ImGui", CDFRExternal *InParent = nullptr);
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 
 #include <Misc/math3d.hpp>
 #include <ArucoPipeline/StaticObject.hpp>
@@ -66,25 +68,15 @@ void ObjectTracker::UnregisterTrackedObject(shared_ptr<TrackedObject> object)
 
 
 
-bool ObjectTracker::SolveCameraLocation(CameraFeatureData& CameraData)
+bool TrackerSnapshot::SolveCameraLocation(CameraFeatureData& CameraData) const
 {
 	CameraData.WorldToCamera = Affine3d::Identity();
 	float score = 0;
 	map<std::pair<int, int>, ArucoCornerArray> ReprojectedCorners; //index in array, corners
-	for (auto object : objects)
+	for (auto &object : StaticObjects)
 	{
-		auto *staticobj = dynamic_cast<StaticObject*>(object.get());
-		if (staticobj == nullptr)
-		{
-			continue;
-		}
-		if (staticobj->IsRelative())
-		{
-			cerr << "SolveCameraLocation isn't meant for inside-out tracking !" << endl;
-			assert(0);
-		}
 		float surface, reprojectionError;
-		Affine3d CameraToStatic = staticobj->GetObjectTransform(CameraData, surface, reprojectionError, ReprojectedCorners);
+		Affine3d CameraToStatic = object->GetObjectTransform(CameraData, surface, reprojectionError, ReprojectedCorners);
 		float newscore = surface;
 		if (newscore <= score)
 		{
@@ -106,12 +98,58 @@ bool ObjectTracker::SolveCameraLocation(CameraFeatureData& CameraData)
 	return score >0;
 }
 
+bool ObjectTracker::SolveCameraLocation(CameraFeatureData& CameraData)
+{
+	return GetSnapshot(false)->SolveCameraLocation(CameraData);
+}
+
+shared_ptr<const TrackerSnapshot> ObjectTracker::GetSnapshot(bool WithPointsOfInterest) const
+{
+	auto snapshot = make_shared<TrackerSnapshot>();
+	for (auto &object : objects)
+	{
+		//relative static objects are inside-out tracking, the camera can't be located from them
+		auto *staticobj = dynamic_cast<StaticObject*>(object.get());
+		if (staticobj == nullptr || staticobj->IsRelative())
+		{
+			continue;
+		}
+		snapshot->StaticObjects.push_back(object);
+	}
+	if (WithPointsOfInterest)
+	{
+		snapshot->PointsOfInterest = GetPointsOfInterest();
+	}
+	snapshot->LargestArucoSize = GetLargestArucoSize();
+	return snapshot;
+}
+
 void ObjectTracker::SolveLocationsPerObject(vector<CameraFeatureData>& CameraData, TrackedObject::TimePoint Tick)
 {
 	const int NumCameras = CameraData.size();
 	//const int NumObjects = objects.size();
 	vector<map<std::pair<int, int>, ArucoCornerArray>> ReprojectedCorners;
 	ReprojectedCorners.resize(NumCameras);
+
+	TrackedObject::TimePoint ReferenceTime = TrackedObject::TimePoint::min();
+	for (const auto &ThisCameraData : CameraData)
+	{
+		ReferenceTime = max(ReferenceTime, ThisCameraData.GrabTime);
+	}
+	if (ReferenceTime == TrackedObject::TimePoint::min() || ReferenceTime == TrackedObject::TimePoint())
+	{
+		ReferenceTime = Tick;
+	}
+	vector<double> TimeOffsets(NumCameras, 0);
+	for (int CamIdx = 0; CamIdx < NumCameras; CamIdx++)
+	{
+		if (CameraData[CamIdx].GrabTime == TrackedObject::TimePoint())
+		{
+			continue;
+		}
+		double offset = chrono::duration<double>(ReferenceTime - CameraData[CamIdx].GrabTime).count();
+		TimeOffsets[CamIdx] = clamp(offset, 0.0, MaxTimeAlignment);
+	}
 	
 	/*parallel_for_(Range(0, objects.size()), [&](const Range& range)
 	{*/
@@ -133,6 +171,7 @@ void ObjectTracker::SolveLocationsPerObject(vector<CameraFeatureData>& CameraDat
 			}
 			
 			vector<ResolvedLocation> locations;
+			Vec3d Velocity = object->GetVelocity();
 			for (size_t CameraIdx = 0; CameraIdx < CameraData.size(); CameraIdx++)
 			{
 				CameraFeatureData& ThisCameraData = CameraData[CameraIdx];
@@ -148,7 +187,12 @@ void ObjectTracker::SolveLocationsPerObject(vector<CameraFeatureData>& CameraDat
 				{
 					continue;
 				}
-				locations.emplace_back(ScoreThis, transformProposed, ThisCameraData.WorldToCamera);
+				//move the whole view, so the ray from the camera to the object keeps its direction
+				Vec3d Shift = Velocity*TimeOffsets[CameraIdx];
+				Affine3d CameraShifted = ThisCameraData.WorldToCamera;
+				CameraShifted.translation(CameraShifted.translation() + Shift);
+				transformProposed.translation(transformProposed.translation() + Shift);
+				locations.emplace_back(ScoreThis, transformProposed, CameraShifted);
 			}
 			if (locations.size() == 0)
 			{
@@ -156,12 +200,12 @@ void ObjectTracker::SolveLocationsPerObject(vector<CameraFeatureData>& CameraDat
 			}
 			if (locations.size() == 1)
 			{
-				object->SetLocation(locations[0].WorldToObject, Tick);
+				object->SetLocation(locations[0].WorldToObject, ReferenceTime);
 				//cout << "Object " << object->Name << " is at location " << objects[ObjIdx]->GetLocation().translation() << " / score: " << locations[0].score << ", seen by 1 camera" << endl;
 				continue;
 			}
 			auto combinedloc = ResolvedLocation::IntersectMultiview(locations);
-			object->SetLocation(combinedloc, Tick);
+			object->SetLocation(combinedloc, ReferenceTime);
 			//cout << "Object " << object->Name << " is at location " << objects[ObjIdx]->GetLocation().translation() << " / score: " << best.score+secondbest.score << ", seen by " << locations.size() << " cameras" << endl;
 		}
 	//});
@@ -206,6 +250,19 @@ double ObjectTracker::GetArucoSize(int number)
 	return ArucoSizes[number];
 }
 
+double ObjectTracker::GetLargestArucoSize() const
+{
+	double largest = 0;
+	for (size_t i = 0; i < ArucoMap.size(); i++)
+	{
+		if (ArucoMap[i] >= 0)
+		{
+			largest = max(largest, ArucoSizes[i]);
+		}
+	}
+	return largest;
+}
+
 vector<vector<Point3d>> ObjectTracker::GetPointsOfInterest() const
 {
 	vector<vector<Point3d>> poi;
@@ -82,7 +82,8 @@ cv::Affine3d TrackedObject::ArucoViewCameraLocal::FitPlane()
 TrackedObject::TrackedObject()
 	:Unique(true),
 	CoplanarTags(false),
-	Location(cv::Affine3d::Identity())
+	Location(cv::Affine3d::Identity()),
+	Velocity(0,0,0)
 {
 	LocationFilter = cv::KalmanFilter(9, 3, 0, CV_64F);
 
@@ -93,8 +94,20 @@ TrackedObject::TrackedObject()
 
 bool TrackedObject::SetLocation(Affine3d InLocation, TimePoint Tick)
 {
-	Location = InLocation;
 	double dt = chrono::duration<double>(Tick - LastSeenTick).count();
+	if (LastSeenTick != TimePoint() && dt > 0 && dt < MaxVelocityGap)
+	{
+		Vec3d measured = (InLocation.translation() - Location.translation())/dt;
+		if (norm(measured) < MaxSpeed)
+		{
+			Velocity = Velocity*(1-VelocitySmoothing) + measured*VelocitySmoothing;
+		}
+	}
+	else if (dt >= MaxVelocityGap || LastSeenTick == TimePoint())
+	{
+		Velocity = Vec3d(0,0,0);
+	}
+	Location = InLocation;
 	LastSeenTick = Tick;
 	if (1) //disable kalman filtering
 	{
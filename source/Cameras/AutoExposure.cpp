@@ -0,0 +1,134 @@
+#include "Cameras/AutoExposure.hpp"
+
+#include <array>
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+#include <Cameras/Camera.hpp>
+#include <Cameras/ImageTypes.hpp>
+#include <Communication/ProcessedTypes.hpp>
+
+using namespace std;
+using namespace cv;
+
+optional<AutoExposureController::TagExposure> AutoExposureController::Measure(const CameraImageData &ImageData, const CameraFeatureData &FeatureData)
+{
+	if (ImageData.Image.empty())
+	{
+		return nullopt;
+	}
+	Mat Image = ImageData.Image.getMat(ACCESS_READ);
+	Rect ImageRect(Point(0,0), Image.size());
+	array<uint32_t, 256> Histogram{};
+	uint32_t NumPixels = 0;
+	TagExposure exposure;
+	Mat Gray;
+	for (size_t lensidx = 0; lensidx < FeatureData.Lenses.size(); lensidx++)
+	{
+		const LensFeatureData &lens = FeatureData.Lenses[lensidx];
+		for (const ArucoCornerArray &corners : lens.ArucoCorners)
+		{
+			//corners are relative to the lens ROI
+			Rect TagRect = (boundingRect(corners) + lens.ROI.tl()) & ImageRect;
+			if (TagRect.area() <= 0)
+			{
+				continue;
+			}
+			if (Image.channels() == 1)
+			{
+				Gray = Image(TagRect);
+			}
+			else
+			{
+				cvtColor(Image(TagRect), Gray, COLOR_BGR2GRAY);
+			}
+			for (int row = 0; row < Gray.rows; row++)
+			{
+				const uchar* ptr = Gray.ptr<uchar>(row);
+				for (int col = 0; col < Gray.cols; col++)
+				{
+					Histogram[ptr[col]]++;
+				}
+			}
+			NumPixels += TagRect.area();
+			exposure.NumTags++;
+		}
+	}
+	if (NumPixels == 0)
+	{
+		return nullopt;
+	}
+	uint32_t DarkCount = NumPixels / 10, BrightCount = NumPixels - NumPixels / 10;
+	uint32_t cumulated = 0;
+	bool DarkFound = false;
+	for (int level = 0; level < 256; level++)
+	{
+		cumulated += Histogram[level];
+		if (!DarkFound && cumulated > DarkCount)
+		{
+			exposure.Dark = level;
+			DarkFound = true;
+		}
+		if (cumulated >= BrightCount)
+		{
+			exposure.Bright = level;
+			break;
+		}
+	}
+	uint32_t SaturatedCount = 0;
+	for (int level = 250; level < 256; level++)
+	{
+		SaturatedCount += Histogram[level];
+	}
+	exposure.Saturated = (float)SaturatedCount / NumPixels;
+	return exposure;
+}
+
+void AutoExposureController::Update(Camera &Cam, const CameraImageData &ImageData, const CameraFeatureData &FeatureData)
+{
+	FramesSinceChange++;
+	LastExposure = Measure(ImageData, FeatureData);
+	if (!LastExposure.has_value() || FramesSinceChange < SettleFrames)
+	{
+		return;
+	}
+	const TagExposure &exposure = LastExposure.value();
+	int error = TargetBright - exposure.Bright;
+	//clipped whites read as 255 whatever the overexposure, so always step down when too many are
+	if (exposure.Saturated > 0.05f)
+	{
+		error = min(error, -Tolerance-1);
+	}
+	if (abs(error) <= Tolerance)
+	{
+		return;
+	}
+	int step = clamp(abs(error) / 8, 1, 8);
+	int brightness = Cam.GetControl(CameraControl::Brightness);
+	int gain = Cam.GetControl(CameraControl::Gain);
+	if (error > 0)
+	{
+		if (brightness < MaxBrightness)
+		{
+			brightness = min(brightness + step, MaxBrightness);
+		}
+		else
+		{
+			gain = min(gain + step, MaxGain);
+		}
+	}
+	else
+	{
+		if (gain > MinGain)
+		{
+			gain = max(gain - step, MinGain);
+		}
+		else
+		{
+			brightness = max(brightness - step, MinBrightness);
+		}
+	}
+	Cam.QueueControl(CameraControl::Brightness, brightness);
+	Cam.QueueControl(CameraControl::Gain, gain);
+	FramesSinceChange = 0;
+}
@@ -3,6 +3,7 @@
 #include <filesystem>
 #include <set>
 #include <fstream>
+#include <sstream>
 #include <Misc/path.hpp>
 #include <nlohmann/json.hpp>
 #include <Misc/MatToJSON.hpp>
@@ -83,6 +84,69 @@ void writeCameraParameters(std::filesystem::path path, Mat camMatrix, Mat distCo
 	writeCameraParameters(path, sett);
 }
 
+bool CameraParametersFromString(const std::string &Contents, CameraSettings &Settings)
+{
+	nlohmann::json object;
+	try
+	{
+		object = nlohmann::json::parse(Contents);
+	}
+	catch(const std::exception& e)
+	{
+		cerr << "Failed to parse camera parameters : " << e.what() << endl;
+		return false;
+	}
+	cv::Size current_resolution = JsonToSize<int>(object.at("Current Resolution"));
+	for (auto &&calibration : object.at("Calibrations"))
+	{
+		cv::Size stored_resolution = JsonToSize<int>(calibration.at("Resolution"));
+		if (current_resolution != stored_resolution)
+		{
+			continue;
+		}
+		Settings.Lenses.clear();
+		for (auto &&lens_json : calibration.at("Lenses"))
+		{
+			LensSettings lens_struct;
+			lens_struct.CameraMatrix = JsonToMatrix<double>(lens_json.at("Camera Matrix"));
+			lens_struct.distanceCoeffs = JsonToMatrix<double>(lens_json.at("Distortion Coefficients"));
+			lens_struct.ROI = JsonToRect<int>(lens_json.at("ROI"));
+			lens_struct.CameraToLens = JsonToAffine3<double>(lens_json.at("Transform"));
+			Settings.Lenses.push_back(lens_struct);
+		}
+		Settings.Resolution = current_resolution;
+		Settings.WantUndistortion = calibration.at("Want Undistortion");
+		Settings.UndistortFocalLengthDivider = calibration.at("Undistortion Focal Length Divider");
+		Settings.UndistortResolutionMultiplier = calibration.at("Undistortion Resolution Multiplier");
+		Settings.IsMonochrome = object.at("Monochrome");
+		return true;
+	}
+	return false;
+}
+
+std::string CameraParametersToString(const CameraSettings &Settings)
+{
+	nlohmann::json object, calibration;
+	object["Current Resolution"] = SizeToJson<int>(Settings.Resolution);
+	object["Monochrome"] = Settings.IsMonochrome;
+	calibration["Resolution"] = SizeToJson<int>(Settings.Resolution);
+	calibration["Want Undistortion"] = Settings.WantUndistortion;
+	calibration["Undistortion Focal Length Divider"] = Settings.UndistortFocalLengthDivider;
+	calibration["Undistortion Resolution Multiplier"] = Settings.UndistortResolutionMultiplier;
+	nlohmann::json &lenses = calibration["Lenses"];
+	for (size_t i = 0; i < Settings.Lenses.size(); i++)	
+	{
+		nlohmann::json &lens = lenses[i];
+		const LensSettings &lenss = Settings.Lenses[i];
+		lens["Camera Matrix"] = MatrixToJson<double>(lenss.CameraMatrix);
+		lens["Distortion Coefficients"] = MatrixToJson<double>(lenss.distanceCoeffs);
+		lens["ROI"] = RectToJson<int>(lenss.ROI);
+		lens["Transform"] = Affine3ToJson<double>(lenss.CameraToLens);
+	}
+	object["Calibrations"][0] = calibration;
+	return object.dump(1, '\t');
+}
+
 bool readCameraParameters(std::filesystem::path path, CameraSettings &Settings)
 {
 	CleanCalibrationPath(path);
@@ -121,35 +185,10 @@ bool readCameraParameters(std::filesystem::path path, CameraSettings &Settings)
 	}
 	else if (path.extension() == ".json")
 	{
-		nlohmann::json object;
 		std::ifstream file(path);
-		file >> object;
-		cv::Size current_resolution = JsonToSize<int>(object.at("Current Resolution"));
-		for (auto &&calibration : object.at("Calibrations"))
-		{
-			cv::Size stored_resolution = JsonToSize<int>(calibration.at("Resolution"));
-			if (current_resolution != stored_resolution)
-			{
-				continue;
-			}
-			Settings.Lenses.clear();
-			for (auto &&lens_json : calibration.at("Lenses"))
-			{
-				LensSettings lens_struct;
-				lens_struct.CameraMatrix = JsonToMatrix<double>(lens_json.at("Camera Matrix"));
-				lens_struct.distanceCoeffs = JsonToMatrix<double>(lens_json.at("Distortion Coefficients"));
-				lens_struct.ROI = JsonToRect<int>(lens_json.at("ROI"));
-				lens_struct.CameraToLens = JsonToAffine3<double>(lens_json.at("Transform"));
-				Settings.Lenses.push_back(lens_struct);
-			}
-			Settings.Resolution = current_resolution;
-			Settings.WantUndistortion = calibration.at("Want Undistortion");
-			Settings.UndistortFocalLengthDivider = calibration.at("Undistortion Focal Length Divider");
-			Settings.UndistortResolutionMultiplier = calibration.at("Undistortion Resolution Multiplier");
-			Settings.IsMonochrome = object.at("Monochrome");
-			return true;
-		}
-		return false;
+		std::stringstream contents;
+		contents << file.rdbuf();
+		return CameraParametersFromString(contents.str(), Settings);
 	}
 	else
 	{
@@ -175,27 +214,9 @@ void writeCameraParameters(std::filesystem::path path, const CameraSettings &Set
 	fs.write("camera_matrix", camMatrix);
 	fs.write("distortion_coefficients", distCoeffs);
 #else
-	nlohmann::json object, calibration;
-	object["Current Resolution"] = SizeToJson<int>(Settings.Resolution);
-	object["Monochrome"] = Settings.IsMonochrome;
-	calibration["Resolution"] = SizeToJson<int>(Settings.Resolution);
-	calibration["Want Undistortion"] = Settings.WantUndistortion;
-	calibration["Undistortion Focal Length Divider"] = Settings.UndistortFocalLengthDivider;
-	calibration["Undistortion Resolution Multiplier"] = Settings.UndistortResolutionMultiplier;
-	nlohmann::json &lenses = calibration["Lenses"];
-	for (size_t i = 0; i < Settings.Lenses.size(); i++)	
-	{
-		nlohmann::json &lens = lenses[i];
-		const LensSettings &lenss = Settings.Lenses[i];
-		lens["Camera Matrix"] = MatrixToJson<double>(lenss.CameraMatrix);
-		lens["Distortion Coefficients"] = MatrixToJson<double>(lenss.distanceCoeffs);
-		lens["ROI"] = RectToJson<int>(lenss.ROI);
-		lens["Transform"] = Affine3ToJson<double>(lenss.CameraToLens);
-	}
-	object["Calibrations"][0] = calibration;
 	path.replace_extension(".json");
 	ofstream file(path);
-	file << object.dump(1, '\t');
+	file << CameraParametersToString(Settings);
 #endif
 }
 
@@ -9,6 +9,7 @@
 #include <opencv2/calib3d.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
+#include <opencv2/imgcodecs.hpp>
 
 #include <Misc/math2d.hpp>
 #include <Misc/math3d.hpp>
@@ -18,6 +19,7 @@
 
 #include <ArucoPipeline/ObjectTracker.hpp>
 #include <Misc/GlobalConf.hpp>
+#include <Transport/thread-rename.hpp>
 
 using namespace cv;
 using namespace std;
@@ -29,7 +31,54 @@ void Camera::RegisterError()
 
 void Camera::RegisterNoError()
 {
-	errors = std::max(0, errors -1);
+	//the capture thread and the manager both touch it
+	int current = errors;
+	while (current > 0 && !errors.compare_exchange_weak(current, current -1))
+	{
+	}
+}
+
+void Camera::ApplyDecodeReduction(int Reduction)
+{
+	if (Reduction <= 1)
+	{
+		return;
+	}
+	//the jpeg decoder rounds up, and output pixel centers are at (x+0.5)/Reduction-0.5
+	auto scale_size = [Reduction](int v){return (v+Reduction-1)/Reduction;};
+	auto scale_rect = [Reduction](Rect2i r){return Rect2i(r.x/Reduction, r.y/Reduction, r.width/Reduction, r.height/Reduction);};
+	Settings->Resolution = Size(scale_size(Settings->Resolution.width), scale_size(Settings->Resolution.height));
+	for (auto &lens : Settings->Lenses)
+	{
+		lens.ROI = scale_rect(lens.ROI);
+		lens.StereoROI = scale_rect(lens.StereoROI);
+		if (lens.CameraMatrix.empty())
+		{
+			continue;
+		}
+		//the matrix may be shared with other copies of the settings
+		lens.CameraMatrix = lens.CameraMatrix.clone();
+		lens.CameraMatrix.at<double>(0,0) /= Reduction;
+		lens.CameraMatrix.at<double>(1,1) /= Reduction;
+		lens.CameraMatrix.at<double>(0,2) = (lens.CameraMatrix.at<double>(0,2)+0.5)/Reduction-0.5;
+		lens.CameraMatrix.at<double>(1,2) = (lens.CameraMatrix.at<double>(1,2)+0.5)/Reduction-0.5;
+	}
+	HasUndistortionMaps = false;
+}
+
+int Camera::GetGrayscaleDecodeFlags(int Reduction)
+{
+	switch (Reduction)
+	{
+	case 2:
+		return IMREAD_REDUCED_GRAYSCALE_2;
+	case 4:
+		return IMREAD_REDUCED_GRAYSCALE_4;
+	case 8:
+		return IMREAD_REDUCED_GRAYSCALE_8;
+	default:
+		return IMREAD_GRAYSCALE;
+	}
 }
 
 const CameraSettings* Camera::GetCameraSettings() const
@@ -88,6 +137,24 @@ void Camera::SetPositionLock(bool state)
 	cout << "Camera " << Name << " is now " << (PositionLocked ? "LOCKED" : "Unlocked") << endl;
 }
 
+bool Camera::SetLocation(Affine3d InLocation, TimePoint Tick)
+{
+	unique_lock lock(LocationMutex);
+	return TrackedObject::SetLocation(InLocation, Tick);
+}
+
+Affine3d Camera::GetLocation() const
+{
+	unique_lock lock(LocationMutex);
+	return Location;
+}
+
+bool Camera::ShouldBeDisplayed(TimePoint Tick) const
+{
+	unique_lock lock(LocationMutex);
+	return TrackedObject::ShouldBeDisplayed(Tick);
+}
+
 void Camera::UpdateFrameNumber()
 {
 	FrameNumber++;
@@ -128,103 +195,283 @@ bool Camera::Read()
 	return false;
 }
 
-void Camera::Undistort()
+void Camera::ResetControls()
 {
-	
-	#if 1
-	double resolution_multiplier = Settings->UndistortResolutionMultiplier;
-	#else
-	double resolution_multiplier = 1;
-	#endif
-	Size rescaled_resolution = Size2d(Settings->Resolution)*resolution_multiplier;
-	if (!HasUndistortionMaps)
+	FollowedBrightness = GetBrightness();
+	FollowedGain = GetGain();
+	Controls.SetCurrent(CameraControl::Brightness, FollowedBrightness);
+	Controls.SetCurrent(CameraControl::Gain, FollowedGain);
+}
+
+void Camera::ApplyPendingControls()
+{
+	bool Auto = AutoControlled;
+	if (!Auto)
 	{
-		//assert(Settings->IsMono());
-		Size cammatsz = Settings->Lenses[0].CameraMatrix.size();
-		if (cammatsz.height != 3 || cammatsz.width != 3)
+		//going back to manual puts the global values back
+		if (GetBrightness() != FollowedBrightness || WasAutoControlled)
 		{
-			RegisterError();
-			cerr << "Asking for undistortion but camera matrix is invalid ! Camera " << Name << endl;
-			return;
+			FollowedBrightness = GetBrightness();
+			Controls.Push(CameraControl::Brightness, FollowedBrightness);
 		}
-		//cout << "Creating undistort map using Camera Matrix " << endl << setcopy.CameraMatrix << endl 
-		//<< " and Distance coeffs " << endl << setcopy.distanceCoeffs << endl;
-		LensesUndistorted.resize(Settings->Lenses.size());
-		std::vector<Matx33d> R(Settings->Lenses.size());
-		for (size_t i = 0; i < Settings->Lenses.size(); i++)
+		if (GetGain() != FollowedGain || WasAutoControlled)
 		{
-			auto &lens = Settings->Lenses[i];
-			auto &lens_undist = LensesUndistorted[i];
-			lens_undist = lens;
-
-			lens_undist.CameraMatrix = Settings->Lenses[i].CameraMatrix.clone();
-			
-			float focal_length_multiplier = Settings->UndistortFocalLengthDivider;
-			double& cx = lens_undist.CameraMatrix.at<double>(0,2), &cy = lens_undist.CameraMatrix.at<double>(1,2);
-			lens_undist.CameraMatrix.at<double>(0,0) *= resolution_multiplier/focal_length_multiplier;
-			lens_undist.CameraMatrix.at<double>(1,1) *= resolution_multiplier/focal_length_multiplier;
-			cx *= resolution_multiplier;
-			cy *= resolution_multiplier;
-			cout << "cx = " << cx << " cy = " << cy << endl;
-			lens_undist.distanceCoeffs = Mat::zeros(4,1, CV_64F);
-
-			lens_undist.ROI = Rect2i(lens.ROI.tl()*resolution_multiplier, lens.ROI.br()*resolution_multiplier);
-			R[i] = Matx33d::eye();
+			FollowedGain = GetGain();
+			Controls.Push(CameraControl::Gain, FollowedGain);
 		}
-		#if 1
-		if (Settings->IsStereo())
+	}
+	WasAutoControlled = Auto;
+	Controls.Apply([this](CameraControl Control, int Value)
+	{
+		if (!ApplyControl(Control, Value))
 		{
-			auto &lens1 = Settings->Lenses[0], &lens2 = Settings->Lenses[1];
-			Affine3d Lens1ToLens2 = lens1.CameraToLens.inv() * lens2.CameraToLens;
-			Affine3d Lens2ToLens1 = Lens1ToLens2.inv();
-			#if 1
-			Matx33d &R1 = R[0], &R2 = R[1];
-			#else
-			Matx33d R1, R2;
-			#endif
-			Affine3d &AffineToUse = Lens2ToLens1;
-			auto R = AffineToUse.rotation();
-			auto T = AffineToUse.translation();
-			Mat &P1 = LensesUndistorted[0].CameraMatrix, &P2 = LensesUndistorted[1].CameraMatrix;
-			Mat &Q = DisparityToDepth;
-			cout << " C1 = " << P1 << " C2 = " << P2 <<  endl;
-			stereoRectify(P1, lens1.distanceCoeffs, P2, lens2.distanceCoeffs,
-				lens1.ROI.size(), R, T, R1, R2, P1, P2, Q, 
-				CALIB_ZERO_DISPARITY, -1, lens1.ROI.size(), &LensesUndistorted[0].StereoROI, &LensesUndistorted[1].StereoROI);
-			
-			auto R_new = R2*R*R1.inv();
-			auto T_new = R2*T;
-			Affine3d Lens2ToLens1_new(R_new, T_new);
-			LensesUndistorted[1].CameraToLens = lens1.CameraToLens*Lens2ToLens1_new.inv();
-
-			cout << " R = " << R << " R_new = " << R_new << " T = " << T << " T_new = " << T_new << endl;
-
-			cout << "Q = " << Q << " P1 = " << P1 << " P2 = " << P2 <<  endl;
+			cerr << "Failed to set control " << (int)Control << " to " << Value << " on camera " << Name << endl;
 		}
-		#endif
+	});
+}
+
+void Camera::StartCaptureThread()
+{
+	if (CaptureThread)
+	{
+		return;
+	}
+	CaptureKilled = false;
+	CaptureThread = make_unique<thread>(&Camera::CaptureThreadEntryPoint, this);
+}
+
+void Camera::StopCaptureThread()
+{
+	if (!CaptureThread)
+	{
+		return;
+	}
+	CaptureKilled = true;
+	CaptureThread->join();
+	CaptureThread.reset();
+}
+
+void Camera::CaptureThreadEntryPoint()
+{
+	string ThreadName = string("Capture ") + Name.substr(0, 8);
+	SetThreadName(ThreadName.c_str());
+	while (!CaptureKilled)
+	{
+		auto GrabStart = chrono::steady_clock::now();
+		Grab();
+		auto ReadStart = chrono::steady_clock::now();
+		if (!Read())
+		{
+			//errors are counted by Read, don't spin on a dead device while the manager gets rid of it
+			this_thread::sleep_for(chrono::milliseconds(10));
+			continue;
+		}
+		CapturedFrame &frame = LatestFrame.GetBack();
+		frame.Image = LastFrameDistorted;
+		frame.GrabTime = captureTime;
+		frame.FrameNumber = FrameNumber;
+		frame.Compressed = LastCompressed;
+		frame.GrabDuration = ReadStart - GrabStart;
+		frame.ReadDuration = chrono::steady_clock::now() - ReadStart;
+		bool dropped;
+		{
+			unique_lock lock(NewFrameMutex);
+			dropped = LatestFrame.Publish();
+		}
+		NewFrameCondition.notify_one();
+		if (dropped)
+		{
+			DroppedFrames++;
+		}
+		ApplyPendingControls();
+	}
+}
+
+bool Camera::NextFrame(chrono::milliseconds Timeout)
+{
+	LastFrameUndistorted = UMat();
+	UndistortedROIs.clear();
+	if (!CaptureThread)
+	{
+		if (Replay && !Processing.Image.empty())
+		{
+			auto next = GetNextRecordedTime();
+			if (!next.has_value())
+			{
+				RegisterError();
+				Processing = CapturedFrame();
+				return false;
+			}
+			if (next.value() > Replay->GetTime())
+			{
+				//nothing new at this point of the timeline, the other cameras moved : present the same frame again
+				Processing.GrabDuration = Processing.ReadDuration = {};
+				return true;
+			}
+		}
+		else if (Replay)
+		{
+			auto next = GetNextRecordedTime();
+			if (next.has_value() && next.value() > Replay->GetTime())
+			{
+				//recording starts later than the others
+				return false;
+			}
+		}
+		auto GrabStart = chrono::steady_clock::now();
+		Grab();
+		auto ReadStart = chrono::steady_clock::now();
+		if (!Read())
+		{
+			Processing = CapturedFrame();
+			return false;
+		}
+		Processing.Image = LastFrameDistorted;
+		Processing.GrabTime = captureTime;
+		Processing.FrameNumber = FrameNumber;
+		Processing.Compressed = LastCompressed;
+		Processing.GrabDuration = ReadStart - GrabStart;
+		Processing.ReadDuration = chrono::steady_clock::now() - ReadStart;
+		ApplyPendingControls();
+		return true;
+	}
+	CapturedFrame* frame = LatestFrame.Take();
+	if (!frame)
+	{
+		unique_lock lock(NewFrameMutex);
+		NewFrameCondition.wait_for(lock, Timeout, [this](){return LatestFrame.HasNew() || CaptureKilled;});
+		frame = LatestFrame.Take();
+	}
+	if (!frame)
+	{
+		Processing = CapturedFrame();
+		return false;
+	}
+	Processing = *frame;
+	return true;
+}
+
+bool Camera::UpdateUndistortionMaps()
+{
+	if (HasUndistortionMaps)
+	{
+		return true;
+	}
+	#if 1
+	double resolution_multiplier = Settings->UndistortResolutionMultiplier;
+	#else
+	double resolution_multiplier = 1;
+	#endif
+	//assert(Settings->IsMono());
+	Size cammatsz = Settings->Lenses[0].CameraMatrix.size();
+	if (cammatsz.height != 3 || cammatsz.width != 3)
+	{
+		RegisterError();
+		cerr << "Asking for undistortion but camera matrix is invalid ! Camera " << Name << endl;
+		return false;
+	}
+	//cout << "Creating undistort map using Camera Matrix " << endl << setcopy.CameraMatrix << endl 
+	//<< " and Distance coeffs " << endl << setcopy.distanceCoeffs << endl;
+	LensesUndistorted.resize(Settings->Lenses.size());
+	std::vector<Matx33d> R(Settings->Lenses.size());
+	for (size_t i = 0; i < Settings->Lenses.size(); i++)
+	{
+		auto &lens = Settings->Lenses[i];
+		auto &lens_undist = LensesUndistorted[i];
+		lens_undist = lens;
+
+		lens_undist.CameraMatrix = Settings->Lenses[i].CameraMatrix.clone();
+		
+		float focal_length_multiplier = Settings->UndistortFocalLengthDivider;
+		double& cx = lens_undist.CameraMatrix.at<double>(0,2), &cy = lens_undist.CameraMatrix.at<double>(1,2);
+		lens_undist.CameraMatrix.at<double>(0,0) *= resolution_multiplier/focal_length_multiplier;
+		lens_undist.CameraMatrix.at<double>(1,1) *= resolution_multiplier/focal_length_multiplier;
+		cx *= resolution_multiplier;
+		cy *= resolution_multiplier;
+		cout << "cx = " << cx << " cy = " << cy << endl;
+		lens_undist.distanceCoeffs = Mat::zeros(4,1, CV_64F);
 
-		UndistMaps.resize(LensesUndistorted.size());
+		lens_undist.ROI = Rect2i(lens.ROI.tl()*resolution_multiplier, lens.ROI.br()*resolution_multiplier);
+		R[i] = Matx33d::eye();
+	}
+	#if 1
+	if (Settings->IsStereo())
+	{
+		auto &lens1 = Settings->Lenses[0], &lens2 = Settings->Lenses[1];
+		Affine3d Lens1ToLens2 = lens1.CameraToLens.inv() * lens2.CameraToLens;
+		Affine3d Lens2ToLens1 = Lens1ToLens2.inv();
+		#if 1
+		Matx33d &R1 = R[0], &R2 = R[1];
+		#else
+		Matx33d R1, R2;
+		#endif
+		Affine3d &AffineToUse = Lens2ToLens1;
+		auto R = AffineToUse.rotation();
+		auto T = AffineToUse.translation();
+		Mat &P1 = LensesUndistorted[0].CameraMatrix, &P2 = LensesUndistorted[1].CameraMatrix;
+		Mat &Q = DisparityToDepth;
+		cout << " C1 = " << P1 << " C2 = " << P2 <<  endl;
+		stereoRectify(P1, lens1.distanceCoeffs, P2, lens2.distanceCoeffs,
+			lens1.ROI.size(), R, T, R1, R2, P1, P2, Q, 
+			CALIB_ZERO_DISPARITY, -1, lens1.ROI.size(), &LensesUndistorted[0].StereoROI, &LensesUndistorted[1].StereoROI);
 		
-		for (size_t i = 0; i < Settings->Lenses.size(); i++)
+		auto R_new = R2*R*R1.inv();
+		auto T_new = R2*T;
+		Affine3d Lens2ToLens1_new(R_new, T_new);
+		LensesUndistorted[1].CameraToLens = lens1.CameraToLens*Lens2ToLens1_new.inv();
+
+		cout << " R = " << R << " R_new = " << R_new << " T = " << T << " T_new = " << T_new << endl;
+
+		cout << "Q = " << Q << " P1 = " << P1 << " P2 = " << P2 <<  endl;
+	}
+	#endif
+
+	UndistMaps.resize(LensesUndistorted.size());
+	
+	for (size_t i = 0; i < Settings->Lenses.size(); i++)
+	{
+		auto &lens = Settings->Lenses[i];
+		auto &lens_undist = LensesUndistorted[i];
+		//UndistMaps[i].first = UMat(lens_undist.ROI.size(), CV_32FC1); UndistMaps[i].second = UMat(lens_undist.ROI.size(), CV_32FC1);
+		Mat map1(lens_undist.ROI.size(), CV_32FC1), map2(lens_undist.ROI.size(), CV_32FC1);
+		initUndistortRectifyMap(lens.CameraMatrix, lens.distanceCoeffs, R[i], 
+		lens_undist.CameraMatrix, lens_undist.ROI.size(), map1.type(), map1, map2);
+		if (GetCaptureConfig().CompactUndistortMaps)
 		{
-			auto &lens = Settings->Lenses[i];
-			auto &lens_undist = LensesUndistorted[i];
-			//UndistMaps[i].first = UMat(lens_undist.ROI.size(), CV_32FC1); UndistMaps[i].second = UMat(lens_undist.ROI.size(), CV_32FC1);
-			Mat map1(lens_undist.ROI.size(), CV_32FC1), map2(lens_undist.ROI.size(), CV_32FC1);
-			initUndistortRectifyMap(lens.CameraMatrix, lens.distanceCoeffs, R[i], 
-			lens_undist.CameraMatrix, lens_undist.ROI.size(), map1.type(), map1, map2);
-			map1.copyTo(UndistMaps[i].first);
-			map2.copyTo(UndistMaps[i].second);
-			//lens_undist.CameraToLens = Affine3d(lens_undist.CameraToLens.rotation() * R[i].inv(), lens_undist.CameraToLens.translation());
+			//fixed point coordinates + interpolation table index, half the memory of the float maps and faster to remap
+			Mat map1fixed, map2fixed;
+			convertMaps(map1, map2, map1fixed, map2fixed, CV_16SC2);
+			map1 = map1fixed;
+			map2 = map2fixed;
 		}
-		HasUndistortionMaps = true;
+		map1.copyTo(UndistMaps[i].first);
+		map2.copyTo(UndistMaps[i].second);
+		//lens_undist.CameraToLens = Affine3d(lens_undist.CameraToLens.rotation() * R[i].inv(), lens_undist.CameraToLens.translation());
 	}
+	HasUndistortionMaps = true;
+	return true;
+}
+
+void Camera::Undistort()
+{
+	
+	#if 1
+	double resolution_multiplier = Settings->UndistortResolutionMultiplier;
+	#else
+	double resolution_multiplier = 1;
+	#endif
+	Size rescaled_resolution = Size2d(Settings->Resolution)*resolution_multiplier;
+	if (!UpdateUndistortionMaps())
+	{
+		return;
+	}
+	UndistortedROIs.clear();
 	try
 	{
-		LastFrameUndistorted = UMat(rescaled_resolution, LastFrameDistorted.type());
+		LastFrameUndistorted = UndistortedFrames.Get(rescaled_resolution, Processing.Image.type());
 		for (size_t i = 0; i < LensesUndistorted.size(); i++)
 		{
-			remap(LastFrameDistorted(Settings->Lenses[i].ROI), LastFrameUndistorted(LensesUndistorted[i].ROI), 
+			remap(Processing.Image(Settings->Lenses[i].ROI), LastFrameUndistorted(LensesUndistorted[i].ROI), 
 				UndistMaps[i].first, UndistMaps[i].second, INTER_LINEAR);
 		}
 	}
@@ -235,6 +482,44 @@ void Camera::Undistort()
 	}
 }
 
+void Camera::Undistort(const vector<Rect> &ROIs)
+{
+	if (!UpdateUndistortionMaps())
+	{
+		return;
+	}
+	Size rescaled_resolution = Size2d(Settings->Resolution)*Settings->UndistortResolutionMultiplier;
+	try
+	{
+		LastFrameUndistorted = UndistortedFrames.Get(rescaled_resolution, Processing.Image.type());
+		//pooled buffer : outside the ROIs it still holds an older frame, which the views would show as current
+		LastFrameUndistorted.setTo(Scalar::all(0));
+		UndistortedROIs.clear();
+		for (size_t i = 0; i < LensesUndistorted.size(); i++)
+		{
+			const Rect &LensROI = LensesUndistorted[i].ROI;
+			for (const Rect &ROI : ROIs)
+			{
+				Rect Clipped = ROI & LensROI;
+				if (Clipped.area() == 0)
+				{
+					continue;
+				}
+				//the maps hold absolute source coordinates, so a part of the map still reads from the whole distorted lens
+				Rect MapROI = Clipped - LensROI.tl();
+				remap(Processing.Image(Settings->Lenses[i].ROI), LastFrameUndistorted(Clipped), 
+					UndistMaps[i].first(MapROI), UndistMaps[i].second(MapROI), INTER_LINEAR);
+				UndistortedROIs.push_back(Clipped);
+			}
+		}
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "Camera undistort failed : " << e.what() << '\n';
+		return;
+	}
+}
+
 CameraImageData Camera::GetFrame(bool Distorted) const
 {
 	//assert(Settings->IsMono() || Distorted);
@@ -244,30 +529,39 @@ CameraImageData Camera::GetFrame(bool Distorted) const
 	if (Distorted)
 	{
 		frame.lenses = Settings->Lenses;
-		frame.Image = LastFrameDistorted;
+		//LastFrameDistorted belongs to the capture thread when there is one
+		frame.Image = Processing.Image;
 	}
 	else
 	{
 		GetCameraSettingsAfterUndistortion(frame.lenses);
 		frame.Image = LastFrameUndistorted;
+		frame.ValidROIs = UndistortedROIs;
 		if (Settings->IsStereo())
 		{
 			frame.DisparityToDepth = DisparityToDepth;
 		}
 		
 	}
-	frame.GrabTime = captureTime;
+	frame.GrabTime = Processing.GrabTime;
 	frame.Valid = true;
 	return frame;
 }
 
 vector<ObjectData> Camera::ToObjectData() const
 {
-	ObjectData camera(ObjectType::Camera, Name, Location, LastSeenTick);
+	Affine3d LocationCopy;
+	TimePoint LastSeenCopy;
+	{
+		unique_lock lock(LocationMutex);
+		LocationCopy = Location;
+		LastSeenCopy = LastSeenTick;
+	}
+	ObjectData camera(ObjectType::Camera, Name, LocationCopy, LastSeenCopy);
 	std::vector<ObjectData> datas = {camera};
 	for (size_t lensidx = 0; lensidx < Settings->Lenses.size(); lensidx++)
 	{
-		datas.emplace_back(ObjectType::Lens, "Lens " + to_string(lensidx), Location * Settings->Lenses[lensidx].CameraToLens, LastSeenTick);
+		datas.emplace_back(ObjectType::Lens, "Lens " + to_string(lensidx), LocationCopy * Settings->Lenses[lensidx].CameraToLens, LastSeenCopy);
 	}
 	
 	return datas;
@@ -276,52 +570,22 @@ vector<ObjectData> Camera::ToObjectData() const
 void Camera::Record(filesystem::path rootPath, int RecordIdx)
 {
 	string folderstr = Name.substr(0, std::min<size_t>(Name.find(' '), 10));
-	filesystem::create_directories(rootPath/folderstr);
-	if (!RecordOutput)
-	{
-		RecordOutput = make_unique<VideoWriter>();
-		#if 0
-		cout << "VIDEOWRITER_PROP_QUALITY returned " << RecordOutput->set(VIDEOWRITER_PROP_QUALITY, 95) << endl;
-		RecordOutput->open(rootPath/folderstr/"video.avi", 
-		#else
-		ostringstream ss;
-		ss << "appsrc ! videoconvert ! x264enc bitrate=100000 speed-preset=faster " 
-		<< (Settings->Lenses.size() == 2 ? "frame-packing=side-by-side " : "") 
-		<< "! avimux ! filesink location=" << rootPath/folderstr/"video.avi";
-		RecordOutput->open(ss.str(), CAP_GSTREAMER, 
-		#endif
-			cv::VideoWriter::fourcc('M', 'P', 'E', 'G'), 
-			30,
-			Settings->Resolution,
-			GetFrame(true).Image.channels() > 1);
-		cout << "Opened recording :" << RecordOutput->isOpened() <<endl;
-	}
-	if (!TimestampsOutput)
-	{
-		TimestampsOutput = make_unique<ofstream>(rootPath/folderstr/"timestamps.txt");
-		writeCameraParameters(rootPath/folderstr/"calibration.json", *Settings.get());
-	}
-	
 	#if 1
 	(void) RecordIdx;
-	if (RecordOutput)
+	if (!Recorder)
 	{
-		auto image = GetFrame(true);
-		RecordOutput->write(image.Image);
-		if (TimestampsOutput)
-		{
-			if (!record_start.has_value())
-			{
-				record_start = image.GrabTime;
-			}
-			auto delta = (image.GrabTime - record_start.value());
-			*TimestampsOutput.get() << delta.count() << endl;
-		}
-		
+		bool Raw = GetCaptureConfig().RecordRaw;
+		Recorder = make_unique<CameraRecorder>(rootPath/folderstr, *Settings.get(), Name, Raw);
+		//the queued frames stay out of the pool until they are written, don't let a slow encoder make it allocate every frame
+		Frames.SetMaxFrames(FramePool::DefaultMaxFrames + Recorder->GetCapacity());
+		//from the next frame on, keep what the camera sent so it can be stored as is
+		KeepCompressed = Raw;
 	}
-
-	
+	auto image = GetFrame(true);
+	//the recorder holds a reference, the pool won't hand this buffer out again until it has been encoded
+	Recorder->Push({image.Image, Processing.Compressed, image.GrabTime, Processing.FrameNumber});
 	#else
+	filesystem::create_directories(rootPath/folderstr);
 	char buffer[16]= {0};
 	snprintf(buffer, sizeof(buffer)-1, "%04d", RecordIdx);
 	auto writepath = rootPath/folderstr/(string(buffer) + string(".jpg"));
@@ -13,20 +13,32 @@ void CameraManager::SetIdle(bool value)
 
 vector<Camera*> CameraManager::Tick()
 {
+	bool detached = false;
 	for (size_t i = 0; i < Cameras.size(); i++)
 	{
-		if (Cameras[i]->errors >= 20 || Idle)
+		std::string pathtofind = dynamic_cast<const VideoCaptureCameraSettings*>(Cameras[i]->GetCameraSettings())->DeviceInfo.device_paths[0];
+		bool removed;
 		{
-			std::cerr << "Detaching camera @ " << Cameras[i]->GetName() << std::endl;
-			std::string pathtofind = dynamic_cast<const VideoCaptureCameraSettings*>(Cameras[i]->GetCameraSettings())->DeviceInfo.device_paths[0];
+			shared_lock lock(pathmutex);
+			removed = removedpaths.find(pathtofind) != removedpaths.end();
+		}
+		if (Cameras[i]->errors >= 20 || Idle || removed)
+		{
+			std::cerr << "Detaching camera @ " << Cameras[i]->GetName() << (removed ? " (device removed)" : "") << std::endl;
 			StopCamera(Cameras[i]);
 			
 			unique_lock lock(pathmutex);
 			usedpaths.erase(pathtofind);
+			removedpaths.erase(pathtofind);
 			Cameras.erase(std::next(Cameras.begin(), i));
 			i--;
+			detached = true;
 		}
 	}
+	if (detached)
+	{
+		OnCamerasDetached();
+	}
 	{
 		unique_lock lock(cammutex);
 		for (auto &Camera : NewCameras)
@@ -3,8 +3,10 @@
 #include <filesystem>
 #include <fstream>
 #include <regex>
+#include <optional>
 #include <nlohmann/json.hpp>
 #include <Cameras/Calibfile.hpp>
+#include <Cameras/RawRecording.hpp>
 #include <Misc/path.hpp>
 #include <Misc/GlobalConf.hpp>
 #include <Transport/thread-rename.hpp>
@@ -107,6 +109,54 @@ void TurnFolderToVideo(std::filesystem::path folderPath)
 	
 }
 
+vector<Camera*> CameraManagerSimulation::Tick()
+{
+	auto cams = CameraManager::Tick();
+	{
+		unique_lock lock(cammutex);
+		if (NewClock)
+		{
+			Clock = move(NewClock);
+		}
+	}
+	if (!Clock)
+	{
+		return cams;
+	}
+	//the earliest frame not presented yet, whichever camera it belongs to
+	optional<int64_t> next;
+	for (auto cam : cams)
+	{
+		auto camnext = cam->GetNextRecordedTime();
+		if (camnext.has_value() && (!next.has_value() || camnext.value() < next.value()))
+		{
+			next = camnext;
+		}
+	}
+	if (!next.has_value())
+	{
+		return cams;
+	}
+	if (!Clock->IsStarted())
+	{
+		Clock->Start(next.value());
+	}
+	else
+	{
+		Clock->Advance(next.value());
+	}
+	return cams;
+}
+
+chrono::steady_clock::time_point CameraManagerSimulation::GetTickTime() const
+{
+	if (Clock && Clock->IsStarted())
+	{
+		return Clock->GetTimePoint();
+	}
+	return CameraManager::GetTickTime();
+}
+
 void CameraManagerSimulation::ThreadEntryPoint()
 {
 	SetThreadName("CameraManagerSimulation");
@@ -166,6 +216,9 @@ void CameraManagerSimulation::ThreadEntryPoint()
 			break;
 		}
 		
+		//all the cameras of the scenario are registered on the same tick, with a new timeline
+		auto ScenarioClock = make_shared<ReplayClock>(RealTime.value_or(GetScenarioRealTime()));
+		vector<shared_ptr<Camera>> ScenarioCameras;
 		for (auto &i : decoded.items())
 		{
 			filesystem::path calibpath, videopath;
@@ -173,8 +226,12 @@ void CameraManagerSimulation::ThreadEntryPoint()
 			try
 			{
 				auto value = i.value();
-				calibpath = rootPath / value["calibration"];
 				videopath = rootPath / value["video"];
+				//raw recordings carry their own calibration
+				if (value.contains("calibration") || videopath.extension() != RawRecording::Extension)
+				{
+					calibpath = rootPath / value["calibration"];
+				}
 				if (value.contains("locks") && value["locks"].is_array())
 				{
 					for (auto &&i : value["locks"])
@@ -193,7 +250,10 @@ void CameraManagerSimulation::ThreadEntryPoint()
 			}
 			
 			VideoCaptureCameraSettings settings;
-			readCameraParameters(calibpath, settings);
+			if (!calibpath.empty())
+			{
+				readCameraParameters(calibpath, settings);
+			}
 			settings.StartType = CameraStartType::PLAYBACK;
 			settings.StartPath = videopath;
 			settings.DeviceInfo.device_paths.push_back(videopath);
@@ -207,16 +267,24 @@ void CameraManagerSimulation::ThreadEntryPoint()
 				unique_lock lock(pathmutex);
 				continue;
 			}
+			if (cam->GetNextRecordedTime().has_value())
 			{
-				{
-					unique_lock lock(pathmutex);
-					usedpaths.emplace(videopath);
-				}
-				{
-					unique_lock lock(cammutex);
-					NewCameras.emplace_back(cam);
-				}
+				cam->SetReplayClock(ScenarioClock);
 			}
+			else
+			{
+				cerr << "Virtual camera " << videopath << " has no timestamps, it will not be kept in step with the others" << endl;
+			}
+			{
+				unique_lock lock(pathmutex);
+				usedpaths.emplace(videopath);
+			}
+			ScenarioCameras.push_back(cam);
+		}
+		{
+			unique_lock lock(cammutex);
+			NewCameras.insert(NewCameras.end(), ScenarioCameras.begin(), ScenarioCameras.end());
+			NewClock = ScenarioClock;
 		}
 		NumberOfInvocation++;
 	}
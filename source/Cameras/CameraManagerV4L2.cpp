@@ -5,8 +5,57 @@
 #include <Misc/path.hpp>
 #include <Transport/thread-rename.hpp>
 
+#include <future>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
 using namespace std;
 
+CameraManagerV4L2::CameraManagerV4L2(CameraStartType InStart, std::string InFilter, bool InAllowNoCalib)
+	:CameraManager(), Start(InStart), Filter(InFilter), AllowNoCalib(InAllowNoCalib)
+{
+	WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+CameraManagerV4L2::~CameraManagerV4L2()
+{
+	//the scan thread closes WakeFd when it exits
+	killed = true;
+	RequestRescan();
+}
+
+void CameraManagerV4L2::SetIdle(bool value)
+{
+	CameraManager::SetIdle(value);
+	if (!value)
+	{
+		RequestRescan();
+	}
+}
+
+void CameraManagerV4L2::RequestRescan()
+{
+	if (WakeFd < 0)
+	{
+		return;
+	}
+	uint64_t one = 1;
+	if (write(WakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+	{
+		cerr << "Failed to wake the camera scan thread : " << strerror(errno) << endl;
+	}
+}
+
+void CameraManagerV4L2::OnCamerasDetached()
+{
+	//a camera that glitched is usually still there, try to start it again right away
+	RequestRescan();
+}
+
 
 bool CameraManagerV4L2::DeviceInFilter(v4l2::devices::DEVICE_INFO device, std::string Filter)
 {
@@ -90,76 +139,171 @@ vector<VideoCaptureCameraSettings> CameraManagerV4L2::autoDetectCameras(CameraSt
 	return detected;
 }
 
-void CameraManagerV4L2::ThreadEntryPoint()
+void CameraManagerV4L2::Rescan()
 {
-	SetThreadName("CameraManagerV4L2");
-	while (!killed)
+	std::vector<v4l2::devices::DEVICE_INFO> devices;
+	v4l2::devices::list(devices);
+	std::set<std::string> knownpaths, unknownpaths;
+	{
+		shared_lock lock(pathmutex);
+		std::copy(usedpaths.begin(), usedpaths.end(), std::inserter(knownpaths, knownpaths.end()));
+		std::copy(blockedpaths.begin(), blockedpaths.end(), std::inserter(knownpaths, knownpaths.end()));
+	}
+	
+	struct PendingStart
+	{
+		v4l2::devices::DEVICE_INFO Device;
+		future<shared_ptr<Camera>> Started;
+	};
+	vector<PendingStart> Starting;
+
+	for (auto &device : devices)
 	{
-		if (Idle)
+		std::string pathtofind = device.device_paths[0];
+		auto pos = std::find(knownpaths.begin(), knownpaths.end(), pathtofind);
+		if (pos != knownpaths.end()) //new camera
 		{
-			this_thread::sleep_for(chrono::milliseconds(1000));
 			continue;
 		}
-		
-		std::vector<v4l2::devices::DEVICE_INFO> devices;
-		v4l2::devices::list(devices);
-		std::set<std::string> knownpaths, unknownpaths;
+
+		VideoCaptureCameraSettings settings = DeviceToSettings(device, Start);
+		if (!settings.IsValid()) //no valid settings
 		{
-			shared_lock lock(pathmutex);
-			std::copy(usedpaths.begin(), usedpaths.end(), std::inserter(knownpaths, knownpaths.end()));
-			std::copy(blockedpaths.begin(), blockedpaths.end(), std::inserter(knownpaths, knownpaths.end()));
+			std::cerr << "Failed to open camera " << device.device_description << " @ " << pathtofind << " : Invalid settings" << std::endl;
+			unique_lock lock(pathmutex);
+			blockedpaths.emplace(pathtofind);
+			continue;
 		}
-		
 
-		for (auto &device : devices)
+		bool HasCalib = settings.IsValidCalibration();
+		if (!AllowNoCalib && !HasCalib)
 		{
-			std::string pathtofind = device.device_paths[0];
-			auto pos = std::find(knownpaths.begin(), knownpaths.end(), pathtofind);
-			if (pos != knownpaths.end()) //new camera
-			{
-				continue;
-			}
+			std::cerr << "Did not open camera " << device.device_description << " @ " << pathtofind << " : Camera has no calibration" << std::endl;
+			unique_lock lock(pathmutex);
+			blockedpaths.emplace(pathtofind);
+			continue;
+		}
+		//cout << "Camera matrix : " << settings.CameraMatrix << " / Distance coeffs : " << settings.distanceCoeffs << endl;
+		//opening a camera blocks for a while in the driver, start them all at the same time
+		Starting.push_back({device, async(launch::async, StartCamera, settings)});
+	}
 
-			VideoCaptureCameraSettings settings = DeviceToSettings(device, Start);
-			if (!settings.IsValid()) //no valid settings
+	for (auto &start : Starting)
+	{
+		std::string pathtofind = start.Device.device_paths[0];
+		auto cam = start.Started.get();
+		if (!cam)
+		{
+			std::cerr << "Did not open camera " << start.Device.device_description << " @ " << pathtofind << " : StartCamera returned null" << std::endl;
+			unique_lock lock(pathmutex);
+			blockedpaths.emplace(pathtofind);
+			continue;
+		}
+
+		{
 			{
-				std::cerr << "Failed to open camera " << device.device_description << " @ " << pathtofind << " : Invalid settings" << std::endl;
 				unique_lock lock(pathmutex);
-				blockedpaths.emplace(pathtofind);
-				continue;
+				usedpaths.emplace(pathtofind);
 			}
-
-			bool HasCalib = settings.IsValidCalibration();
-			if (!AllowNoCalib && !HasCalib)
 			{
-				std::cerr << "Did not open camera " << device.device_description << " @ " << pathtofind << " : Camera has no calibration" << std::endl;
-				unique_lock lock(pathmutex);
-				blockedpaths.emplace(pathtofind);
-				continue;
+				unique_lock lock(cammutex);
+				NewCameras.emplace_back(cam);
 			}
-			//cout << "Camera matrix : " << settings.CameraMatrix << " / Distance coeffs : " << settings.distanceCoeffs << endl;
-			auto cam = StartCamera(settings);
-			if (!cam)
+			
+		}
+	}
+}
+
+bool CameraManagerV4L2::HandleDeviceEvents(int InotifyFd)
+{
+	bool changed = false;
+	alignas(inotify_event) char buffer[4096];
+	while (true)
+	{
+		ssize_t len = read(InotifyFd, buffer, sizeof(buffer));
+		if (len <= 0)
+		{
+			break;
+		}
+		for (char* ptr = buffer; ptr < buffer + len; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len)
+		{
+			const inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+			if (event->len == 0 || strncmp(event->name, "video", 5) != 0)
 			{
-				std::cerr << "Did not open camera " << device.device_description << " @ " << pathtofind << " : StartCamera returned null" << std::endl;
-				unique_lock lock(pathmutex);
-				blockedpaths.emplace(pathtofind);
 				continue;
 			}
-
+			changed = true;
+			string path = string("/dev/") + event->name;
+			unique_lock lock(pathmutex);
+			if (event->mask & IN_DELETE)
 			{
+				cout << "Camera device " << path << " removed" << endl;
+				//a device that comes back at the same path deserves another try
+				blockedpaths.erase(path);
+				if (usedpaths.find(path) != usedpaths.end())
 				{
-					unique_lock lock(pathmutex);
-					usedpaths.emplace(pathtofind);
+					removedpaths.emplace(path);
 				}
-				{
-					unique_lock lock(cammutex);
-					NewCameras.emplace_back(cam);
-				}
-				
 			}
 		}
+	}
+	return changed;
+}
 
-		this_thread::sleep_for(std::chrono::milliseconds(1000));
+void CameraManagerV4L2::ThreadEntryPoint()
+{
+	SetThreadName("CameraManagerV4L2");
+	int InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (InotifyFd >= 0 && inotify_add_watch(InotifyFd, "/dev", IN_CREATE | IN_DELETE | IN_ATTRIB) < 0)
+	{
+		close(InotifyFd);
+		InotifyFd = -1;
 	}
-}
\ No newline at end of file
+	if (InotifyFd < 0)
+	{
+		cerr << "Failed to watch /dev for cameras (" << strerror(errno) << "), scanning every second instead" << endl;
+	}
+	bool NeedsRescan = true;
+	while (!killed)
+	{
+		if (NeedsRescan && !Idle)
+		{
+			Rescan();
+			NeedsRescan = false;
+		}
+		//the timeout is only there to notice killed, or to scan when /dev can't be watched
+		pollfd fds[2] = {{InotifyFd, POLLIN, 0}, {WakeFd, POLLIN, 0}};
+		int ready = poll(fds, 2, 1000);
+		if (InotifyFd < 0)
+		{
+			NeedsRescan = true;
+			continue;
+		}
+		if (ready <= 0)
+		{
+			continue;
+		}
+		if (fds[1].revents & POLLIN)
+		{
+			uint64_t count;
+			if (read(WakeFd, &count, sizeof(count)) > 0)
+			{
+				NeedsRescan = true;
+			}
+		}
+		if (fds[0].revents & POLLIN)
+		{
+			this_thread::sleep_for(SettleDelay);
+			NeedsRescan |= HandleDeviceEvents(InotifyFd);
+		}
+	}
+	if (InotifyFd >= 0)
+	{
+		close(InotifyFd);
+	}
+	if (WakeFd >= 0)
+	{
+		close(WakeFd);
+		WakeFd = -1;
+	}
+}
@@ -0,0 +1,118 @@
+#include "Cameras/CameraRecorder.hpp"
+
+#include <iostream>
+#include <sstream>
+
+#include <Cameras/Calibfile.hpp>
+#include <Transport/thread-rename.hpp>
+
+using namespace std;
+using namespace cv;
+
+CameraRecorder::CameraRecorder(filesystem::path InFolder, const CameraSettings &InSettings, string InName, bool InRaw, size_t InCapacity)
+	:Folder(InFolder), Settings(InSettings), Name(InName), Raw(InRaw), Queue(InCapacity), Capacity(InCapacity)
+{
+	Thread = make_unique<thread>(&CameraRecorder::ThreadEntryPoint, this);
+}
+
+CameraRecorder::~CameraRecorder()
+{
+	Queue.Close();
+	if (Thread)
+	{
+		Thread->join();
+	}
+	if (Dropped > 0)
+	{
+		cerr << "Recording of " << Name << " dropped " << Dropped << " frames out of " << Dropped + Written << endl;
+	}
+}
+
+void CameraRecorder::Push(Frame InFrame)
+{
+	Dropped += Queue.PushDropOldest(move(InFrame));
+}
+
+bool CameraRecorder::Open(const Frame &First)
+{
+	filesystem::create_directories(Folder);
+	if (Raw)
+	{
+		//the settings are stored in the file, with the resolution the frames were decoded to
+		CameraSettings RecordedSettings = Settings;
+		RecordedSettings.Resolution = First.Image.size();
+		RawOutput = make_unique<RawRecording::Writer>();
+		bool opened = RawOutput->Open(Folder/(string("video") + RawRecording::Extension), RecordedSettings);
+		cout << "Opened raw recording :" << opened << endl;
+		return opened;
+	}
+	Output = make_unique<VideoWriter>();
+	#if 0
+	cout << "VIDEOWRITER_PROP_QUALITY returned " << Output->set(VIDEOWRITER_PROP_QUALITY, 95) << endl;
+	Output->open(Folder/"video.avi", 
+	#else
+	ostringstream ss;
+	ss << "appsrc ! videoconvert ! x264enc bitrate=100000 speed-preset=faster " 
+	<< (Settings.Lenses.size() == 2 ? "frame-packing=side-by-side " : "") 
+	<< "! avimux ! filesink location=" << Folder/"video.avi";
+	Output->open(ss.str(), CAP_GSTREAMER, 
+	#endif
+		cv::VideoWriter::fourcc('M', 'P', 'E', 'G'), 
+		30,
+		First.Image.size(),
+		First.Image.channels() > 1);
+	cout << "Opened recording :" << Output->isOpened() <<endl;
+	TimestampsOutput = make_unique<ofstream>(Folder/"timestamps.txt");
+	writeCameraParameters(Folder/"calibration.json", Settings);
+	return Output->isOpened();
+}
+
+void CameraRecorder::WriteRaw(const Frame &InFrame)
+{
+	int64_t timestamp = chrono::duration_cast<chrono::nanoseconds>(InFrame.GrabTime.time_since_epoch()).count();
+	if (!InFrame.Compressed.empty())
+	{
+		RawOutput->Append(RawRecording::MJPEG, InFrame.Image.size(), InFrame.Compressed.data, 
+			InFrame.Compressed.total() * InFrame.Compressed.elemSize(), timestamp, InFrame.FrameNumber);
+	}
+	else
+	{
+		RawOutput->Append(InFrame.Image.getMat(ACCESS_READ), timestamp, InFrame.FrameNumber);
+	}
+}
+
+void CameraRecorder::ThreadEntryPoint()
+{
+	string ThreadName = string("Record ") + Name.substr(0, 8);
+	SetThreadName(ThreadName.c_str());
+	while (true)
+	{
+		auto frame = Queue.Pop();
+		if (!frame.has_value())
+		{
+			break;
+		}
+		if (!Output && !RawOutput)
+		{
+			Open(frame.value());
+		}
+		if (RawOutput)
+		{
+			WriteRaw(frame.value());
+			Written++;
+			continue;
+		}
+		Output->write(frame->Image);
+		//absolute steady clock time like the raw recordings, so the cameras of a recording share their timeline
+		*TimestampsOutput.get() << chrono::duration_cast<chrono::nanoseconds>(frame->GrabTime.time_since_epoch()).count() << "\n";
+		Written++;
+	}
+	if (TimestampsOutput)
+	{
+		TimestampsOutput->flush();
+	}
+	if (RawOutput)
+	{
+		RawOutput->Close();
+	}
+}
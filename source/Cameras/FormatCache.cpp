@@ -0,0 +1,104 @@
+#include "Cameras/FormatCache.hpp"
+
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+
+#include <nlohmann/json.hpp>
+
+#include <Misc/path.hpp>
+
+using namespace std;
+
+namespace
+{
+	mutex CacheMutex;
+	bool CacheLoaded = false;
+	nlohmann::json Cache;
+
+	filesystem::path GetCachePath()
+	{
+		return GetCyclopsPath() / "cache" / "camera_formats.json";
+	}
+
+	void LoadCache()
+	{
+		if (CacheLoaded)
+		{
+			return;
+		}
+		CacheLoaded = true;
+		Cache = nlohmann::json::object();
+		auto path = GetCachePath();
+		if (!filesystem::exists(path))
+		{
+			return;
+		}
+		try
+		{
+			ifstream file(path);
+			file >> Cache;
+		}
+		catch(const std::exception& e)
+		{
+			cerr << "Failed to read camera format cache, starting from scratch : " << e.what() << endl;
+			Cache = nlohmann::json::object();
+		}
+	}
+}
+
+string GetFormatCacheKey(const VideoCaptureCameraSettings &Settings, int Fourcc)
+{
+	ostringstream key;
+	key << Settings.DeviceInfo.device_description << " @ " << Settings.DeviceInfo.bus_info 
+		<< " " << Settings.Resolution.width << "x" << Settings.Resolution.height
+		<< "@" << (int)Settings.Framerate << "/" << (int)Settings.FramerateDivider << " " << Fourcc;
+	return key.str();
+}
+
+optional<CachedCameraFormat> GetCachedFormat(const string &Key)
+{
+	unique_lock lock(CacheMutex);
+	LoadCache();
+	if (!Cache.contains(Key))
+	{
+		return nullopt;
+	}
+	try
+	{
+		auto &entry = Cache.at(Key);
+		CachedCameraFormat format;
+		format.Resolution = cv::Size(entry.at("width"), entry.at("height"));
+		format.Framerate = entry.at("fps");
+		format.Fourcc = entry.at("fourcc");
+		return format;
+	}
+	catch(const std::exception& e)
+	{
+		cerr << "Invalid camera format cache entry for " << Key << " : " << e.what() << endl;
+		return nullopt;
+	}
+}
+
+void SetCachedFormat(const string &Key, const CachedCameraFormat &Format)
+{
+	unique_lock lock(CacheMutex);
+	LoadCache();
+	nlohmann::json entry;
+	entry["width"] = Format.Resolution.width;
+	entry["height"] = Format.Resolution.height;
+	entry["fps"] = Format.Framerate;
+	entry["fourcc"] = Format.Fourcc;
+	if (Cache.contains(Key) && Cache.at(Key) == entry)
+	{
+		return;
+	}
+	Cache[Key] = entry;
+	auto path = GetCachePath();
+	filesystem::create_directories(path.parent_path());
+	ofstream file(path);
+	file << Cache.dump(1, '\t');
+}
@@ -0,0 +1,49 @@
+#include "Cameras/FramePool.hpp"
+
+using namespace cv;
+using namespace std;
+
+atomic<uint64_t> FramePool::TotalAllocations = 0;
+
+bool FramePool::IsFree(const UMat &Frame)
+{
+	//the pool's own handle is the only reference, and no Mat is mapped on it
+	return Frame.u == nullptr || (Frame.u->urefcount == 1 && Frame.u->refcount == 0);
+}
+
+UMat FramePool::Get(Size Size, int Type)
+{
+	const size_t NumFrames = Frames.size();
+	//prefer a free buffer that already has the right format
+	for (size_t i = 0; i < NumFrames; i++)
+	{
+		size_t idx = (NextIndex + i) % NumFrames;
+		UMat &Frame = Frames[idx];
+		if (Frame.size() == Size && Frame.type() == Type && IsFree(Frame))
+		{
+			NextIndex = (idx + 1) % NumFrames;
+			return Frame;
+		}
+	}
+	TotalAllocations++;
+	UMat NewFrame(Size, Type);
+	if (NumFrames < MaxFrames)
+	{
+		Frames.push_back(NewFrame);
+		return NewFrame;
+	}
+	//pool is full : replace a free buffer of the wrong format, or let the oldest one live on with its holders
+	size_t replaced = NextIndex;
+	for (size_t i = 0; i < NumFrames; i++)
+	{
+		size_t idx = (NextIndex + i) % NumFrames;
+		if (IsFree(Frames[idx]))
+		{
+			replaced = idx;
+			break;
+		}
+	}
+	Frames[replaced] = NewFrame;
+	NextIndex = (replaced + 1) % NumFrames;
+	return NewFrame;
+}
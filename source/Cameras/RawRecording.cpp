@@ -0,0 +1,266 @@
+#include "Cameras/RawRecording.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <Cameras/Calibfile.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace RawRecording
+{
+	static constexpr size_t Alignment = 8;
+
+	static size_t Padding(size_t Length)
+	{
+		return (Alignment - Length % Alignment) % Alignment;
+	}
+
+	Writer::~Writer()
+	{
+		Close();
+	}
+
+	bool Writer::Write(const void* Data, size_t Length)
+	{
+		if (fwrite(Data, 1, Length, File) != Length)
+		{
+			cerr << "Failed to write raw recording : " << strerror(errno) << endl;
+			return false;
+		}
+		Offset += Length;
+		return true;
+	}
+
+	bool Writer::Open(filesystem::path Path, const CameraSettings &Settings)
+	{
+		Close();
+		File = fopen(Path.c_str(), "wb");
+		if (!File)
+		{
+			cerr << "Failed to open raw recording " << Path << " : " << strerror(errno) << endl;
+			return false;
+		}
+		Offset = 0;
+		Index.clear();
+		string SettingsJson = CameraParametersToString(Settings);
+		FileHeader header{};
+		memcpy(header.Magic, Magic, sizeof(Magic));
+		header.Version = Version;
+		header.SettingsLength = SettingsJson.size();
+		uint64_t zeros = 0;
+		if (!Write(&header, sizeof(header)) || !Write(SettingsJson.data(), SettingsJson.size()) 
+			|| !Write(&zeros, Padding(SettingsJson.size())))
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	bool Writer::Append(PixelFormat Format, Size Size, const void* Data, size_t Length, int64_t Timestamp, uint32_t FrameNumber)
+	{
+		if (!File)
+		{
+			return false;
+		}
+		FrameHeader header{};
+		memcpy(header.Magic, FrameMagic, sizeof(FrameMagic));
+		header.Format = Format;
+		header.Width = Size.width;
+		header.Height = Size.height;
+		header.FrameNumber = FrameNumber;
+		header.Length = Length;
+		header.Timestamp = Timestamp;
+		IndexEntry entry{Offset, Timestamp};
+		uint64_t zeros = 0;
+		if (!Write(&header, sizeof(header)) || !Write(Data, Length) || !Write(&zeros, Padding(Length)))
+		{
+			return false;
+		}
+		Index.push_back(entry);
+		return true;
+	}
+
+	bool Writer::Append(const Mat &Image, int64_t Timestamp, uint32_t FrameNumber)
+	{
+		if (Image.depth() != CV_8U || (Image.channels() != 1 && Image.channels() != 3))
+		{
+			cerr << "Raw recordings only take 8 bit gray or BGR images" << endl;
+			return false;
+		}
+		Mat Continuous = Image.isContinuous() ? Image : Image.clone();
+		return Append(Image.channels() == 1 ? Gray8 : BGR8, Image.size(), Continuous.data, 
+			Continuous.total() * Continuous.elemSize(), Timestamp, FrameNumber);
+	}
+
+	void Writer::Close()
+	{
+		if (!File)
+		{
+			return;
+		}
+		Trailer trailer{};
+		trailer.IndexOffset = Offset;
+		trailer.Count = Index.size();
+		memcpy(trailer.Magic, IndexMagic, sizeof(IndexMagic));
+		if (Index.size() > 0)
+		{
+			Write(Index.data(), Index.size() * sizeof(IndexEntry));
+		}
+		Write(&trailer, sizeof(trailer));
+		fclose(File);
+		File = nullptr;
+	}
+
+	Reader::~Reader()
+	{
+		Close();
+	}
+
+	void Reader::Close()
+	{
+		if (Mapping)
+		{
+			munmap((void*)Mapping, MappingLength);
+			Mapping = nullptr;
+		}
+		if (fd >= 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+		Index.clear();
+		SettingsJson.clear();
+	}
+
+	bool Reader::Open(filesystem::path Path)
+	{
+		Close();
+		fd = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			cerr << "Failed to open raw recording " << Path << " : " << strerror(errno) << endl;
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(FileHeader))
+		{
+			cerr << "Raw recording " << Path << " is too short" << endl;
+			Close();
+			return false;
+		}
+		MappingLength = st.st_size;
+		void* map = mmap(nullptr, MappingLength, PROT_READ, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			cerr << "Failed to map raw recording " << Path << " : " << strerror(errno) << endl;
+			Mapping = nullptr;
+			Close();
+			return false;
+		}
+		Mapping = (const uint8_t*)map;
+		//frames are read front to back
+		madvise(map, MappingLength, MADV_SEQUENTIAL);
+
+		const FileHeader* header = (const FileHeader*)Mapping;
+		if (memcmp(header->Magic, Magic, sizeof(Magic)) != 0 || header->Version != Version 
+			|| sizeof(FileHeader) + header->SettingsLength > MappingLength)
+		{
+			cerr << "Raw recording " << Path << " has an invalid header" << endl;
+			Close();
+			return false;
+		}
+		SettingsJson.assign((const char*)Mapping + sizeof(FileHeader), header->SettingsLength);
+		uint64_t FramesStart = sizeof(FileHeader) + header->SettingsLength + Padding(header->SettingsLength);
+
+		bool HasIndex = false;
+		if (MappingLength >= FramesStart + sizeof(Trailer))
+		{
+			const Trailer* trailer = (const Trailer*)(Mapping + MappingLength - sizeof(Trailer));
+			HasIndex = memcmp(trailer->Magic, IndexMagic, sizeof(IndexMagic)) == 0
+				&& trailer->IndexOffset + trailer->Count * sizeof(IndexEntry) + sizeof(Trailer) == MappingLength;
+			if (HasIndex)
+			{
+				const IndexEntry* entries = (const IndexEntry*)(Mapping + trailer->IndexOffset);
+				Index.assign(entries, entries + trailer->Count);
+			}
+		}
+		if (!HasIndex)
+		{
+			cerr << "Raw recording " << Path << " was not closed properly, scanning frames" << endl;
+			ScanFrames(FramesStart);
+		}
+		return true;
+	}
+
+	void Reader::ScanFrames(uint64_t Start)
+	{
+		uint64_t offset = Start;
+		while (offset + sizeof(FrameHeader) <= MappingLength)
+		{
+			const FrameHeader* header = (const FrameHeader*)(Mapping + offset);
+			if (memcmp(header->Magic, FrameMagic, sizeof(FrameMagic)) != 0 
+				|| offset + sizeof(FrameHeader) + header->Length > MappingLength)
+			{
+				//end of the frames, or a frame cut short
+				break;
+			}
+			Index.push_back({offset, header->Timestamp});
+			offset += sizeof(FrameHeader) + header->Length + Padding(header->Length);
+		}
+	}
+
+	bool Reader::GetSettings(CameraSettings &Settings) const
+	{
+		if (SettingsJson.empty())
+		{
+			return false;
+		}
+		return CameraParametersFromString(SettingsJson, Settings);
+	}
+
+	optional<FrameView> Reader::GetFrame(size_t FrameIndex) const
+	{
+		if (FrameIndex >= Index.size())
+		{
+			return nullopt;
+		}
+		uint64_t offset = Index[FrameIndex].Offset;
+		if (offset + sizeof(FrameHeader) > MappingLength)
+		{
+			return nullopt;
+		}
+		const FrameHeader* header = (const FrameHeader*)(Mapping + offset);
+		if (memcmp(header->Magic, FrameMagic, sizeof(FrameMagic)) != 0 
+			|| offset + sizeof(FrameHeader) + header->Length > MappingLength)
+		{
+			return nullopt;
+		}
+		if (header->Width == 0 || header->Height == 0 || header->Width > MaxDimension || header->Height > MaxDimension)
+		{
+			return nullopt;
+		}
+		//uncompressed frames are read in place, their payload has to hold every pixel
+		uint64_t pixels = (uint64_t)header->Width * header->Height;
+		if ((header->Format == Gray8 && header->Length != pixels) 
+			|| (header->Format == BGR8 && header->Length != pixels*3))
+		{
+			return nullopt;
+		}
+		FrameView view;
+		view.Format = (PixelFormat)header->Format;
+		view.Size = Size(header->Width, header->Height);
+		view.FrameNumber = header->FrameNumber;
+		view.Timestamp = header->Timestamp;
+		view.Data = Mapping + offset + sizeof(FrameHeader);
+		view.Length = header->Length;
+		return view;
+	}
+}
@@ -0,0 +1,226 @@
+#include "Cameras/RawRecordingCamera.hpp"
+
+#include <iostream>
+#include <filesystem>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+using namespace cv;
+using namespace std;
+
+static int GetColorDecodeFlags(int Reduction)
+{
+	switch (Reduction)
+	{
+	case 2:
+		return IMREAD_REDUCED_COLOR_2;
+	case 4:
+		return IMREAD_REDUCED_COLOR_4;
+	case 8:
+		return IMREAD_REDUCED_COLOR_8;
+	default:
+		return IMREAD_COLOR;
+	}
+}
+
+bool RawRecordingCamera::StartFeed()
+{
+	if (connected)
+	{
+		return false;
+	}
+	grabbed = false;
+	VideoCaptureCameraSettings* Settingscast = dynamic_cast<VideoCaptureCameraSettings*>(Settings.get());
+	Settingscast->StartPath = filesystem::weakly_canonical(Settingscast->StartPath);
+	Settingscast->ApiID = -1;
+	Name = Settingscast->DeviceInfo.device_description + string(" @ ") + Settingscast->StartPath;
+	cout << "Starting camera @" << Settingscast->StartPath << " from a raw recording" << endl;
+	if (!Recording.Open(Settingscast->StartPath))
+	{
+		return false;
+	}
+	if (Recording.GetFrameCount() == 0)
+	{
+		cerr << "Raw recording " << Settingscast->StartPath << " has no frames" << endl;
+		return false;
+	}
+	CameraSettings Embedded;
+	bool HasEmbedded = Recording.GetSettings(Embedded);
+	if (!Settings->IsValidCalibration())
+	{
+		if (!HasEmbedded)
+		{
+			cerr << "Raw recording " << Settingscast->StartPath << " has no usable settings and no calibration was given" << endl;
+			return false;
+		}
+		Settings->Lenses = Embedded.Lenses;
+		Settings->WantUndistortion = Embedded.WantUndistortion;
+		Settings->UndistortFocalLengthDivider = Embedded.UndistortFocalLengthDivider;
+		Settings->UndistortResolutionMultiplier = Embedded.UndistortResolutionMultiplier;
+		Settings->IsMonochrome = Embedded.IsMonochrome;
+	}
+	auto first = Recording.GetFrame(0);
+	if (!first.has_value())
+	{
+		cerr << "Raw recording " << Settingscast->StartPath << " has an unreadable first frame" << endl;
+		return false;
+	}
+	Settings->Resolution = first->Size;
+	FirstTimestamp = first->Timestamp;
+	NextIndex = 0;
+	DecodeFlags.reset();
+	ResetControls();
+	connected = true;
+	return true;
+}
+
+bool RawRecordingCamera::ApplyControl(CameraControl Control, int Value)
+{
+	(void)Control;
+	(void)Value;
+	//the frames were exposed while recording, there is nothing to adjust
+	return true;
+}
+
+bool RawRecordingCamera::Grab()
+{
+	if (!connected)
+	{
+		return false;
+	}
+	Current = Recording.GetFrame(NextIndex);
+	if (!Current.has_value())
+	{
+		cerr << "Raw recording of camera " << Name << " is over" << endl;
+		grabbed = false;
+		RegisterError();
+		return false;
+	}
+	if (NextIndex == 0)
+	{
+		ReplayStart = chrono::steady_clock::now();
+	}
+	NextIndex++;
+	if (Replay)
+	{
+		//skip the frames the timeline already went past
+		for (auto next = GetNextRecordedTime(); next.has_value() && next.value() <= Replay->GetTime(); next = GetNextRecordedTime())
+		{
+			Current = Recording.GetFrame(NextIndex);
+			NextIndex++;
+		}
+	}
+	RegisterNoError();
+	Camera::Grab();
+	if (Replay)
+	{
+		captureTime = Replay->ToTimePoint(Current->Timestamp);
+	}
+	else
+	{
+		captureTime = ReplayStart + chrono::duration_cast<chrono::steady_clock::duration>(chrono::nanoseconds(Current->Timestamp - FirstTimestamp));
+	}
+	return true;
+}
+
+optional<int64_t> RawRecordingCamera::GetNextRecordedTime() const
+{
+	if (!connected)
+	{
+		return nullopt;
+	}
+	auto next = Recording.GetFrame(NextIndex);
+	if (!next.has_value())
+	{
+		return nullopt;
+	}
+	return next->Timestamp;
+}
+
+bool RawRecordingCamera::DecodeMJPEG(const RawRecording::FrameView &Frame, UMat &Target)
+{
+	Mat Compressed(1, Frame.Length, CV_8UC1, (void*)Frame.Data);
+	if (!DecodeFlags.has_value())
+	{
+		//the camera may have been decoded to a reduced size while recording, the stored size is the decoded one
+		Mat Probe = imdecode(Compressed, Settings->IsMonochrome ? IMREAD_GRAYSCALE : IMREAD_COLOR);
+		if (Probe.empty())
+		{
+			return false;
+		}
+		int Reduction = max(1, Probe.cols / max(1, Frame.Size.width));
+		DecodeFlags = Settings->IsMonochrome ? GetGrayscaleDecodeFlags(Reduction) : GetColorDecodeFlags(Reduction);
+	}
+	Mat TargetMat = Target.getMat(ACCESS_WRITE);
+	uchar* TargetData = TargetMat.data;
+	imdecode(Compressed, DecodeFlags.value(), &TargetMat);
+	return TargetMat.data == TargetData;
+}
+
+bool RawRecordingCamera::Read()
+{
+	if (!connected)
+	{
+		return false;
+	}
+	if (!grabbed && !Grab())
+	{
+		return false;
+	}
+	LastFrameDistorted = UMat();
+	LastCompressed = Mat();
+	const RawRecording::FrameView &Frame = Current.value();
+	int OutType = Settings->IsMonochrome ? CV_8UC1 : CV_8UC3;
+	UMat Target = Frames.Get(Frame.Size, OutType);
+	bool ReadSuccess = true;
+	switch (Frame.Format)
+	{
+	case RawRecording::Gray8:
+		{
+			Mat Source(Frame.Size, CV_8UC1, (void*)Frame.Data);
+			if (Settings->IsMonochrome)
+			{
+				Source.copyTo(Target);
+			}
+			else
+			{
+				cvtColor(Source, Target, COLOR_GRAY2BGR);
+			}
+		}
+		break;
+	case RawRecording::BGR8:
+		{
+			Mat Source(Frame.Size, CV_8UC3, (void*)Frame.Data);
+			if (Settings->IsMonochrome)
+			{
+				cvtColor(Source, Target, COLOR_BGR2GRAY);
+			}
+			else
+			{
+				Source.copyTo(Target);
+			}
+		}
+		break;
+	case RawRecording::MJPEG:
+		ReadSuccess = DecodeMJPEG(Frame, Target);
+		if (ReadSuccess && KeepCompressed)
+		{
+			LastCompressed = Mat(1, Frame.Length, CV_8UC1, (void*)Frame.Data).clone();
+		}
+		break;
+	default:
+		ReadSuccess = false;
+		break;
+	}
+	if (!ReadSuccess)
+	{
+		cerr << "Failed to read recorded frame " << NextIndex-1 << " of camera " << Name << endl;
+		grabbed = false;
+		RegisterError();
+		return false;
+	}
+	LastFrameDistorted = Target;
+	RegisterNoError();
+	Camera::Read();
+	return true;
+}
@@ -0,0 +1,378 @@
+#include "Cameras/V4L2Camera.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+#include <opencv2/imgproc.hpp>
+
+#include <Misc/GlobalConf.hpp>
+
+using namespace cv;
+using namespace std;
+
+V4L2Camera::~V4L2Camera()
+{
+	StopCaptureThread();
+	StopFeed();
+}
+
+bool V4L2Camera::Ioctl(unsigned long Request, void* Arg, const char* RequestName) const
+{
+	int ret;
+	do
+	{
+		ret = ioctl(fd, Request, Arg);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0)
+	{
+		cerr << RequestName << " failed for camera " << Name << " : " << strerror(errno) << endl;
+		return false;
+	}
+	return true;
+}
+
+bool V4L2Camera::SetControl(uint32_t Id, int Value)
+{
+	v4l2_control control{};
+	control.id = Id;
+	control.value = Value;
+	return Ioctl(VIDIOC_S_CTRL, &control, "VIDIOC_S_CTRL");
+}
+
+bool V4L2Camera::QueueBuffer(int Index)
+{
+	v4l2_buffer buf{};
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = Index;
+	return Ioctl(VIDIOC_QBUF, &buf, "VIDIOC_QBUF");
+}
+
+void V4L2Camera::ReleaseDequeued()
+{
+	if (DequeuedIndex < 0)
+	{
+		return;
+	}
+	QueueBuffer(DequeuedIndex);
+	DequeuedIndex = -1;
+	DequeuedSize = 0;
+}
+
+void V4L2Camera::StopFeed()
+{
+	if (Streaming)
+	{
+		int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		Ioctl(VIDIOC_STREAMOFF, &type, "VIDIOC_STREAMOFF");
+		Streaming = false;
+	}
+	DequeuedIndex = -1;
+	for (auto &buffer : Buffers)
+	{
+		if (buffer.Start)
+		{
+			munmap(buffer.Start, buffer.Length);
+		}
+	}
+	Buffers.clear();
+	if (fd >= 0)
+	{
+		close(fd);
+		fd = -1;
+	}
+	connected = false;
+}
+
+bool V4L2Camera::StartFeed()
+{
+	auto globalconf = GetCaptureConfig();
+	if (connected)
+	{
+		return false;
+	}
+	grabbed = false;
+
+	VideoCaptureCameraSettings* Settingscast = dynamic_cast<VideoCaptureCameraSettings*>(Settings.get());
+
+	string pathtodevice = Settingscast->DeviceInfo.device_paths[0];
+	Name = Settingscast->DeviceInfo.device_description + string(" @ ") +  pathtodevice;
+	Settingscast->StartPath = pathtodevice;
+	Settingscast->ApiID = -1;
+
+	cout << "Opening device at \"" << pathtodevice << "\" with V4L2, " << globalconf.V4L2Buffers << " buffers" << endl;
+	fd = open(pathtodevice.c_str(), O_RDWR | O_NONBLOCK);
+	if (fd < 0)
+	{
+		cerr << "Failed to open " << pathtodevice << " : " << strerror(errno) << endl;
+		return false;
+	}
+
+	v4l2_format format{};
+	format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	format.fmt.pix.width = Settings->Resolution.width;
+	format.fmt.pix.height = Settings->Resolution.height;
+	format.fmt.pix.pixelformat = V4L2_PIX_FMT_MJPEG;
+	format.fmt.pix.field = V4L2_FIELD_ANY;
+	if (!Ioctl(VIDIOC_S_FMT, &format, "VIDIOC_S_FMT"))
+	{
+		StopFeed();
+		return false;
+	}
+	//the driver may have picked something else
+	PixelFormat = format.fmt.pix.pixelformat;
+	BytesPerLine = format.fmt.pix.bytesperline;
+	if (PixelFormat != V4L2_PIX_FMT_MJPEG && PixelFormat != V4L2_PIX_FMT_YUYV && PixelFormat != V4L2_PIX_FMT_GREY)
+	{
+		cerr << "Camera " << Name << " does not support MJPEG, YUYV or GREY" << endl;
+		StopFeed();
+		return false;
+	}
+	Settingscast->Resolution = Size(format.fmt.pix.width, format.fmt.pix.height);
+
+	v4l2_streamparm streamparm{};
+	streamparm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	streamparm.parm.capture.timeperframe.numerator = Settings->FramerateDivider;
+	streamparm.parm.capture.timeperframe.denominator = Settings->Framerate;
+	Ioctl(VIDIOC_S_PARM, &streamparm, "VIDIOC_S_PARM");
+
+	v4l2_requestbuffers request{};
+	request.count = max(2, globalconf.V4L2Buffers);
+	request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	request.memory = V4L2_MEMORY_MMAP;
+	if (!Ioctl(VIDIOC_REQBUFS, &request, "VIDIOC_REQBUFS") || request.count < 2)
+	{
+		cerr << "Camera " << Name << " could not allocate capture buffers" << endl;
+		StopFeed();
+		return false;
+	}
+	Buffers.resize(request.count);
+	for (size_t i = 0; i < Buffers.size(); i++)
+	{
+		v4l2_buffer buf{};
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (!Ioctl(VIDIOC_QUERYBUF, &buf, "VIDIOC_QUERYBUF"))
+		{
+			StopFeed();
+			return false;
+		}
+		void* start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+		if (start == MAP_FAILED)
+		{
+			cerr << "Failed to map capture buffer " << i << " of camera " << Name << " : " << strerror(errno) << endl;
+			StopFeed();
+			return false;
+		}
+		Buffers[i].Start = start;
+		Buffers[i].Length = buf.length;
+		MonotonicTimestamps = (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+		if (!QueueBuffer(i))
+		{
+			StopFeed();
+			return false;
+		}
+	}
+	if (!MonotonicTimestamps)
+	{
+		cerr << "WARNING : Camera " << Name << " does not give monotonic timestamps, frames will be timestamped when dequeued" << endl;
+	}
+
+	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (!Ioctl(VIDIOC_STREAMON, &type, "VIDIOC_STREAMON"))
+	{
+		StopFeed();
+		return false;
+	}
+	Streaming = true;
+
+	ResetControls();
+	SetControl(V4L2_CID_BRIGHTNESS, GetControl(CameraControl::Brightness));
+	SetControl(V4L2_CID_GAIN, GetControl(CameraControl::Gain));
+
+	if (Settings->IsMonochrome && PixelFormat == V4L2_PIX_FMT_MJPEG)
+	{
+		int reduction = GetDecodeReduction();
+		DecodeFlags = GetGrayscaleDecodeFlags(reduction);
+		ApplyDecodeReduction(reduction);
+	}
+	else
+	{
+		DecodeFlags = Settings->IsMonochrome ? IMREAD_GRAYSCALE : IMREAD_COLOR;
+	}
+
+	connected = true;
+	return true;
+}
+
+bool V4L2Camera::Grab()
+{
+	if (!connected)
+	{
+		return false;
+	}
+	ReleaseDequeued();
+
+	pollfd pfd{};
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	int ready;
+	do
+	{
+		ready = poll(&pfd, 1, 1000);
+	} while (ready < 0 && errno == EINTR);
+	if (ready <= 0)
+	{
+		cerr << "Failed to grab frame for camera " << Name << " : " << (ready == 0 ? "timed out" : strerror(errno)) << endl;
+		grabbed = false;
+		RegisterError();
+		return false;
+	}
+
+	//drain the ring and keep the most recent frame, older ones go straight back to the driver
+	v4l2_buffer latest{};
+	bool HasFrame = false;
+	while (true)
+	{
+		v4l2_buffer buf{};
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		if (ioctl(fd, VIDIOC_DQBUF, &buf) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN)
+			{
+				cerr << "VIDIOC_DQBUF failed for camera " << Name << " : " << strerror(errno) << endl;
+			}
+			break;
+		}
+		if (HasFrame)
+		{
+			QueueBuffer(latest.index);
+		}
+		latest = buf;
+		HasFrame = true;
+	}
+	if (!HasFrame || (latest.flags & V4L2_BUF_FLAG_ERROR))
+	{
+		if (HasFrame)
+		{
+			QueueBuffer(latest.index);
+		}
+		cerr << "Failed to grab frame for camera " << Name << endl;
+		grabbed = false;
+		RegisterError();
+		return false;
+	}
+	DequeuedIndex = latest.index;
+	DequeuedSize = latest.bytesused;
+
+	RegisterNoError();
+	Camera::Grab();
+	if (MonotonicTimestamps)
+	{
+		//steady_clock is CLOCK_MONOTONIC, the same clock the driver stamps with
+		auto stamp = chrono::seconds(latest.timestamp.tv_sec) + chrono::microseconds(latest.timestamp.tv_usec);
+		captureTime = chrono::steady_clock::time_point(chrono::duration_cast<chrono::steady_clock::duration>(stamp));
+	}
+	return true;
+}
+
+bool V4L2Camera::Read()
+{
+	if (!connected)
+	{
+		return false;
+	}
+	if (!grabbed && !Grab())
+	{
+		return false;
+	}
+	LastFrameDistorted = UMat();
+	LastCompressed = Mat();
+
+	int OutType = Settings->IsMonochrome ? CV_8UC1 : CV_8UC3;
+	UMat Target = Frames.Get(Settings->Resolution, OutType);
+	bool ReadSuccess = true;
+	{
+		Mat TargetMat = Target.getMat(ACCESS_WRITE);
+		void* data = Buffers[DequeuedIndex].Start;
+		switch (PixelFormat)
+		{
+		case V4L2_PIX_FMT_MJPEG:
+			{
+				if (KeepCompressed)
+				{
+					LastCompressed = Mat(1, DequeuedSize, CV_8UC1, data).clone();
+				}
+				//decoded straight into the pooled buffer, if the size doesn't match imdecode reallocates
+				uchar* TargetData = TargetMat.data;
+				imdecode(Mat(1, DequeuedSize, CV_8UC1, data), DecodeFlags, &TargetMat);
+				if (TargetMat.data != TargetData)
+				{
+					cerr << "Decoded frame for camera " << Name << " has size " << TargetMat.size() << " but " << Settings->Resolution << " was expected" << endl;
+					ReadSuccess = false;
+				}
+			}
+			break;
+		case V4L2_PIX_FMT_YUYV:
+			cvtColor(Mat(Settings->Resolution, CV_8UC2, data, BytesPerLine), TargetMat,
+				Settings->IsMonochrome ? COLOR_YUV2GRAY_YUY2 : COLOR_YUV2BGR_YUY2);
+			break;
+		case V4L2_PIX_FMT_GREY:
+			if (Settings->IsMonochrome)
+			{
+				Mat(Settings->Resolution, CV_8UC1, data, BytesPerLine).copyTo(TargetMat);
+			}
+			else
+			{
+				cvtColor(Mat(Settings->Resolution, CV_8UC1, data, BytesPerLine), TargetMat, COLOR_GRAY2BGR);
+			}
+			break;
+		default:
+			ReadSuccess = false;
+			break;
+		}
+	}
+	//the frame has been copied out, the driver can have the buffer back
+	ReleaseDequeued();
+
+	if (!ReadSuccess)
+	{
+		grabbed = false;
+		RegisterError();
+		return false;
+	}
+	LastFrameDistorted = Target;
+	RegisterNoError();
+	Camera::Read();
+	return true;
+}
+
+bool V4L2Camera::ApplyControl(CameraControl Control, int Value)
+{
+	if (fd < 0)
+	{
+		return false;
+	}
+	switch (Control)
+	{
+	case CameraControl::Brightness:
+		return SetControl(V4L2_CID_BRIGHTNESS, Value);
+	case CameraControl::Gain:
+		return SetControl(V4L2_CID_GAIN, Value);
+	default:
+		return false;
+	}
+}
@@ -6,6 +6,7 @@
 #include <sstream>  // string to number conversion
 #include <stdlib.h>
 #include <filesystem>
+#include <fstream>
 #include <thread>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/calib3d.hpp>
@@ -14,6 +15,7 @@
 #include <thirdparty/serialib.h>
 
 #include <Cameras/Calibfile.hpp>
+#include <Cameras/FormatCache.hpp>
 #include <Misc/FrameCounter.hpp>
 
 #include <ArucoPipeline/TrackedObject.hpp> //CameraView
@@ -78,30 +80,92 @@ bool VideoCaptureCamera::StartFeed()
 	//cout << "Aperture system command : " << commandbuffer << endl;
 	//system(commandbuffer);
 	feed = make_unique<VideoCapture>();
-	cout << "Opening device at \"" << Settingscast->StartPath << "\" with API id " << Settingscast->ApiID << endl;
-	feed->open(Settingscast->StartPath, Settingscast->ApiID);
+	if (Settingscast->StartType != CameraStartType::ANY)
+	{
+		cout << "Opening device at \"" << Settingscast->StartPath << "\" with API id " << Settingscast->ApiID << endl;
+		feed->open(Settingscast->StartPath, Settingscast->ApiID);
+	}
 	RealCamera = Settingscast->StartPath.find("/dev/") != string::npos;
+	ResetControls();
 	if (Settingscast->StartType == CameraStartType::ANY)
 	{
-		feed->set(CAP_PROP_FOURCC, VideoWriter::fourcc('M', 'J', 'P', 'G'));
-		//feed->set(CAP_PROP_FOURCC, VideoWriter::fourcc('Y', 'U', 'Y', 'V'));
-		feed->set(CAP_PROP_FRAME_WIDTH, Settings->Resolution.width);
-		feed->set(CAP_PROP_FRAME_HEIGHT, Settings->Resolution.height);
-		feed->set(CAP_PROP_FPS, Settings->Framerate/Settings->FramerateDivider);
-		//feed->set(CAP_PROP_AUTO_EXPOSURE, 3) ;
-		//feed->set(CAP_PROP_EXPOSURE, 300) ;
-		feed->set(CAP_PROP_BUFFERSIZE, 2);
-		LastBrightness = GetBrightness();
-		feed->set(CAP_PROP_BRIGHTNESS, LastBrightness);
-		LastGain = GetGain();
-		feed->set(CAP_PROP_GAIN, LastGain);
-		if (Settings->IsMonochrome && RealCamera)
+		int fourcc = VideoWriter::fourcc('M', 'J', 'P', 'G');
+		//int fourcc = VideoWriter::fourcc('Y', 'U', 'Y', 'V');
+		string cachekey = GetFormatCacheKey(*Settingscast, fourcc);
+		auto cached = GetCachedFormat(cachekey);
+		int brightness = GetControl(CameraControl::Brightness);
+		int gain = GetControl(CameraControl::Gain);
+		bool opened = false;
+		if (cached.has_value())
+		{
+			//known device : ask for the format it gave last time, so the driver doesn't have to fall back to the closest one again
+			//The backends still apply these one property at a time. Any property refused fails the whole open, so the controls are set afterwards
+			vector<int> params = {
+				CAP_PROP_FOURCC, cached->Fourcc,
+				CAP_PROP_FRAME_WIDTH, cached->Resolution.width,
+				CAP_PROP_FRAME_HEIGHT, cached->Resolution.height,
+				CAP_PROP_FPS, (int)round(cached->Framerate),
+				CAP_PROP_BUFFERSIZE, 2
+			};
+			if (Settings->IsMonochrome && RealCamera)
+			{
+				params.insert(params.end(), {CAP_PROP_CONVERT_RGB, 0});
+			}
+			cout << "Opening device at \"" << Settingscast->StartPath << "\" with API id " << Settingscast->ApiID << " and cached format " << cached->Resolution << "@" << cached->Framerate << endl;
+			opened = feed->open(Settingscast->StartPath, Settingscast->ApiID, params);
+			if (!opened)
+			{
+				cerr << "Camera " << Name << " refused its cached format, negotiating again" << endl;
+			}
+		}
+		if (!opened)
 		{
-			feed->set(CAP_PROP_CONVERT_RGB, 0);
+			cout << "Opening device at \"" << Settingscast->StartPath << "\" with API id " << Settingscast->ApiID << endl;
+			feed->open(Settingscast->StartPath, Settingscast->ApiID);
+			feed->set(CAP_PROP_FOURCC, fourcc);
+			feed->set(CAP_PROP_FRAME_WIDTH, Settings->Resolution.width);
+			feed->set(CAP_PROP_FRAME_HEIGHT, Settings->Resolution.height);
+			feed->set(CAP_PROP_FPS, Settings->Framerate/Settings->FramerateDivider);
+			//feed->set(CAP_PROP_AUTO_EXPOSURE, 3) ;
+			//feed->set(CAP_PROP_EXPOSURE, 300) ;
+			feed->set(CAP_PROP_BUFFERSIZE, 2);
+			if (Settings->IsMonochrome && RealCamera)
+			{
+				feed->set(CAP_PROP_CONVERT_RGB, 0);
+			}
 		}
+		feed->set(CAP_PROP_BRIGHTNESS, brightness);
+		feed->set(CAP_PROP_GAIN, gain);
 
 		Settingscast->Resolution.width = feed->get(CAP_PROP_FRAME_WIDTH);
 		Settingscast->Resolution.height = feed->get(CAP_PROP_FRAME_HEIGHT);
+
+		//remember what was negotiated for the next start
+		if (feed->isOpened() && RealCamera)
+		{
+			CachedCameraFormat negotiated;
+			negotiated.Resolution = Settingscast->Resolution;
+			negotiated.Framerate = feed->get(CAP_PROP_FPS);
+			negotiated.Fourcc = (int)feed->get(CAP_PROP_FOURCC);
+			if (negotiated.Fourcc == 0)
+			{
+				negotiated.Fourcc = fourcc;
+			}
+			SetCachedFormat(cachekey, negotiated);
+		}
+
+		if (Settings->IsMonochrome && RealCamera)
+		{
+			DecodeRaw = true;
+			int reduction = GetDecodeReduction();
+			DecodeFlags = GetGrayscaleDecodeFlags(reduction);
+			ApplyDecodeReduction(reduction);
+		}
+	}
+	
+	if (Settingscast->StartType == CameraStartType::PLAYBACK)
+	{
+		LoadRecordedTimes(Settingscast->StartPath);
 	}
 	
 	connected = true;
@@ -109,6 +173,41 @@ bool VideoCaptureCamera::StartFeed()
 	return true;
 }
 
+void VideoCaptureCamera::LoadRecordedTimes(const filesystem::path &VideoPath)
+{
+	RecordedTimes.clear();
+	PlaybackIndex = 0;
+	ifstream timestamps(VideoPath.parent_path() / "timestamps.txt");
+	int64_t timestamp;
+	while (timestamps >> timestamp)
+	{
+		RecordedTimes.push_back(timestamp);
+	}
+	if (RecordedTimes.size() > 0)
+	{
+		return;
+	}
+	int NumFrames = feed->get(CAP_PROP_FRAME_COUNT);
+	double fps = feed->get(CAP_PROP_FPS);
+	if (fps <= 0)
+	{
+		fps = 30;
+	}
+	for (int i = 0; i < NumFrames; i++)
+	{
+		RecordedTimes.push_back(llround(i * 1e9 / fps));
+	}
+}
+
+optional<int64_t> VideoCaptureCamera::GetNextRecordedTime() const
+{
+	if (!connected || PlaybackIndex >= RecordedTimes.size())
+	{
+		return nullopt;
+	}
+	return RecordedTimes[PlaybackIndex];
+}
+
 bool VideoCaptureCamera::Grab()
 {
 	if (!connected)
@@ -117,10 +216,24 @@ bool VideoCaptureCamera::Grab()
 	}
 	bool grabsuccess = false;
 	grabsuccess = feed->grab();
+	PlaybackIndex++;
+	if (grabsuccess && Replay)
+	{
+		//skip the frames the timeline already went past
+		for (auto next = GetNextRecordedTime(); grabsuccess && next.has_value() && next.value() <= Replay->GetTime(); next = GetNextRecordedTime())
+		{
+			grabsuccess = feed->grab();
+			PlaybackIndex++;
+		}
+	}
 	if (grabsuccess)
 	{
 		RegisterNoError();
 		Camera::Grab();
+		if (Replay && PlaybackIndex <= RecordedTimes.size())
+		{
+			captureTime = Replay->ToTimePoint(RecordedTimes[PlaybackIndex-1]);
+		}
 	}
 	else
 	{
@@ -141,32 +254,58 @@ bool VideoCaptureCamera::Read()
 	bool ReadSuccess = false;
 	bool HadGrabbed = grabbed;
 	LastFrameDistorted = UMat();
-	LastFrameUndistorted = UMat();
-	if (HadGrabbed)
+	LastCompressed = Mat();
+	if (DecodeRaw)
 	{
-		ReadSuccess = feed->retrieve(LastFrameDistorted);
+		//the compressed buffer is only needed until it is decoded, so it can be reused
+		ReadSuccess = HadGrabbed ? feed->retrieve(RawFrame) : feed->read(RawFrame);
+		if (ReadSuccess && KeepCompressed)
+		{
+			LastCompressed = RawFrame.clone();
+		}
 	}
 	else
 	{
-		ReadSuccess = feed->read(LastFrameDistorted);
+		//retrieve writes in place when given a buffer of the same format as the last frame
+		if (!LastCaptureSize.empty())
+		{
+			LastFrameDistorted = Frames.Get(LastCaptureSize, LastCaptureType);
+		}
+		ReadSuccess = HadGrabbed ? feed->retrieve(LastFrameDistorted) : feed->read(LastFrameDistorted);
+		LastCaptureSize = LastFrameDistorted.size();
+		LastCaptureType = LastFrameDistorted.type();
 	}
 	
 	if (ReadSuccess)
 	{
 		RegisterNoError();
 		Camera::Read();
-		if (Settings->IsMonochrome)
+		if (DecodeRaw)
 		{
-			if (RealCamera)
-			{
-				Mat temp = imdecode(LastFrameDistorted, IMREAD_GRAYSCALE);
-				temp.copyTo(LastFrameDistorted);
-			}
-			else
+			//luma only, the chroma would be thrown away by the aruco preprocessing anyway
+			//the reduced modes are done by libjpeg in the DCT domain, before the pixels are reconstructed
+			//decoded straight into the pooled buffer
+			LastFrameDistorted = Frames.Get(Settings->Resolution, CV_8UC1);
+			Mat DecodeTarget = LastFrameDistorted.getMat(ACCESS_WRITE);
+			uchar* TargetData = DecodeTarget.data;
+			imdecode(RawFrame, DecodeFlags, &DecodeTarget);
+			bool DecodedInPlace = DecodeTarget.data == TargetData;
+			Size DecodedSize = DecodeTarget.size();
+			DecodeTarget.release();
+			if (!DecodedInPlace)
 			{
-				cvtColor(LastFrameDistorted, LastFrameDistorted, COLOR_BGR2GRAY);
+				cerr << "Decoded frame for camera " << Name << " has size " << DecodedSize << " but " << Settings->Resolution << " was expected" << endl;
+				LastFrameDistorted = UMat();
+				RegisterError();
+				return false;
 			}
 		}
+		else if (Settings->IsMonochrome)
+		{
+			UMat GrayFrame = Frames.Get(LastFrameDistorted.size(), CV_8UC1);
+			cvtColor(LastFrameDistorted, GrayFrame, COLOR_BGR2GRAY);
+			LastFrameDistorted = GrayFrame;
+		}
 	}
 	else
 	{
@@ -176,16 +315,27 @@ bool VideoCaptureCamera::Read()
 		return false;
 	}
 
-	if (GetBrightness() != LastBrightness)
+	return ReadSuccess;
+}
+
+bool VideoCaptureCamera::ApplyControl(CameraControl Control, int Value)
+{
+	if (!feed)
 	{
-		LastBrightness = GetBrightness();
-		feed->set(CAP_PROP_BRIGHTNESS, LastBrightness);
+		return false;
 	}
-	if (GetGain() != LastGain)
+	if (!RealCamera)
 	{
-		LastGain = GetGain();
-		feed->set(CAP_PROP_GAIN, LastGain);
+		//files and pipelines have nothing to adjust
+		return true;
+	}
+	switch (Control)
+	{
+	case CameraControl::Brightness:
+		return feed->set(CAP_PROP_BRIGHTNESS, Value);
+	case CameraControl::Gain:
+		return feed->set(CAP_PROP_GAIN, Value);
+	default:
+		return false;
 	}
-	
-	return ReadSuccess;
 }
\ No newline at end of file
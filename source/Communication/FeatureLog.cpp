@@ -0,0 +1,468 @@
+#include "Communication/FeatureLog.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <type_traits>
+
+#include <Transport/thread-rename.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+	class ByteWriter
+	{
+	private:
+		vector<uint8_t> &Out;
+	public:
+		ByteWriter(vector<uint8_t> &InOut)
+			:Out(InOut)
+		{}
+
+		template<class T>
+		void Put(const T &Value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			size_t pos = Out.size();
+			Out.resize(pos + sizeof(T));
+			memcpy(Out.data() + pos, &Value, sizeof(T));
+		}
+
+		void PutString(const string &Value)
+		{
+			Put<uint32_t>(Value.size());
+			Out.insert(Out.end(), Value.begin(), Value.end());
+		}
+
+		void PutTime(chrono::steady_clock::time_point Time)
+		{
+			Put<int64_t>(chrono::duration_cast<chrono::nanoseconds>(Time.time_since_epoch()).count());
+		}
+
+		void PutAffine(const Affine3d &Value)
+		{
+			Put(Value.matrix);
+		}
+
+		void PutRect(const Rect &Value)
+		{
+			Put<int32_t>(Value.x); Put<int32_t>(Value.y); Put<int32_t>(Value.width); Put<int32_t>(Value.height);
+		}
+
+		//Stored as doubles
+		void PutMat(const Mat &Value)
+		{
+			Mat doubles;
+			if (!Value.empty())
+			{
+				Value.convertTo(doubles, CV_64F);
+			}
+			Put<uint16_t>(doubles.rows);
+			Put<uint16_t>(doubles.cols);
+			for (int row = 0; row < doubles.rows; row++)
+			{
+				for (int col = 0; col < doubles.cols; col++)
+				{
+					Put(doubles.at<double>(row, col));
+				}
+			}
+		}
+
+		void PutObject(const ObjectData &Object)
+		{
+			Put<int32_t>((int32_t)Object.type);
+			PutString(Object.name);
+			PutAffine(Object.location);
+			PutTime(Object.LastSeen);
+			PutString(Object.metadata.is_null() ? string() : Object.metadata.dump());
+			Put<uint32_t>(Object.Childs.size());
+			for (const auto &child : Object.Childs)
+			{
+				PutObject(child);
+			}
+		}
+	};
+
+	class ByteReader
+	{
+	private:
+		const uint8_t* Data;
+		size_t Length;
+		size_t Position = 0;
+	public:
+		bool Failed = false;
+
+		ByteReader(const uint8_t* InData, size_t InLength)
+			:Data(InData), Length(InLength)
+		{}
+
+		template<class T>
+		T Get()
+		{
+			T Value{};
+			if (Position + sizeof(T) > Length)
+			{
+				Failed = true;
+				return Value;
+			}
+			memcpy(&Value, Data + Position, sizeof(T));
+			Position += sizeof(T);
+			return Value;
+		}
+
+		//Number of items that follow, each taking at least MinItemSize bytes
+		//A corrupt count that can't fit in what is left fails instead of making the caller allocate for it
+		template<class T>
+		size_t GetCount(size_t MinItemSize)
+		{
+			size_t Count = Get<T>();
+			if (Failed || Count > (Length - Position) / max<size_t>(MinItemSize, 1))
+			{
+				Failed = true;
+				return 0;
+			}
+			return Count;
+		}
+
+		string GetString()
+		{
+			uint32_t size = Get<uint32_t>();
+			if (Failed || Position + size > Length)
+			{
+				Failed = true;
+				return string();
+			}
+			string Value((const char*)Data + Position, size);
+			Position += size;
+			return Value;
+		}
+
+		chrono::steady_clock::time_point GetTime()
+		{
+			return chrono::steady_clock::time_point(chrono::duration_cast<chrono::steady_clock::duration>(chrono::nanoseconds(Get<int64_t>())));
+		}
+
+		Affine3d GetAffine()
+		{
+			return Affine3d(Get<Matx44d>());
+		}
+
+		Rect GetRect()
+		{
+			Rect Value;
+			Value.x = Get<int32_t>(); Value.y = Get<int32_t>(); Value.width = Get<int32_t>(); Value.height = Get<int32_t>();
+			return Value;
+		}
+
+		Mat GetMat()
+		{
+			//only camera matrices and distortion coefficients are logged
+			const size_t MaxSize = 16;
+			size_t rows = Get<uint16_t>(), cols = Get<uint16_t>();
+			if (Failed || rows*cols == 0)
+			{
+				return Mat();
+			}
+			if (rows > MaxSize || cols > MaxSize || rows*cols*sizeof(double) > Length - Position)
+			{
+				Failed = true;
+				return Mat();
+			}
+			Mat Value(rows, cols, CV_64F);
+			for (size_t row = 0; row < rows; row++)
+			{
+				for (size_t col = 0; col < cols; col++)
+				{
+					Value.at<double>(row, col) = Get<double>();
+				}
+			}
+			return Value;
+		}
+
+		//type, name length, location, time, metadata length and child count
+		static constexpr size_t MinObjectSize = 4 + 4 + sizeof(Matx44d) + 8 + 4 + 4;
+
+		ObjectData GetObject()
+		{
+			ObjectData Object;
+			Object.type = (ObjectType)Get<int32_t>();
+			Object.name = GetString();
+			Object.location = GetAffine();
+			Object.LastSeen = GetTime();
+			string metadata = GetString();
+			if (!metadata.empty())
+			{
+				Object.metadata = nlohmann::json::parse(metadata, nullptr, false);
+			}
+			size_t NumChilds = GetCount<uint32_t>(MinObjectSize);
+			for (size_t i = 0; i < NumChilds && !Failed; i++)
+			{
+				Object.Childs.push_back(GetObject());
+			}
+			return Object;
+		}
+	};
+
+	void Serialise(chrono::steady_clock::time_point Time, CDFRTeam Team, 
+		const vector<CameraFeatureData> &Features, const vector<ObjectData> &Objects, vector<uint8_t> &Out)
+	{
+		ByteWriter writer(Out);
+		writer.PutTime(Time);
+		writer.Put<uint8_t>((uint8_t)Team);
+		writer.Put<uint16_t>(Features.size());
+		for (const CameraFeatureData &camera : Features)
+		{
+			writer.PutString(camera.CameraName);
+			writer.PutTime(camera.GrabTime);
+			writer.Put<int32_t>(camera.FrameSize.width);
+			writer.Put<int32_t>(camera.FrameSize.height);
+			writer.PutAffine(camera.WorldToCamera);
+			writer.Put<uint16_t>(camera.ArucoSegments.size());
+			for (const Rect &segment : camera.ArucoSegments)
+			{
+				writer.PutRect(segment);
+			}
+			writer.Put<uint16_t>(camera.Lenses.size());
+			for (const LensFeatureData &lens : camera.Lenses)
+			{
+				writer.PutAffine(lens.CameraToLens);
+				writer.PutAffine(lens.WorldToLens);
+				writer.PutMat(lens.CameraMatrix);
+				writer.PutMat(lens.ProjectionMatrix);
+				writer.PutMat(lens.DistanceCoefficients);
+				writer.PutRect(lens.ROI);
+				writer.Put<uint16_t>(lens.ArucoIndices.size());
+				for (size_t tagidx = 0; tagidx < lens.ArucoIndices.size(); tagidx++)
+				{
+					writer.Put<int32_t>(lens.ArucoIndices[tagidx]);
+					writer.Put<uint8_t>(tagidx < lens.StereoReprojected.size() && lens.StereoReprojected[tagidx]);
+					const ArucoCornerArray &corners = lens.ArucoCorners[tagidx];
+					writer.Put<uint8_t>(corners.size());
+					for (const Point2f &corner : corners)
+					{
+						writer.Put(corner.x);
+						writer.Put(corner.y);
+					}
+				}
+				writer.Put<uint16_t>(lens.YoloDetections.size());
+				for (const YoloDetection &detection : lens.YoloDetections)
+				{
+					writer.Put(detection.Corners.x); writer.Put(detection.Corners.y);
+					writer.Put(detection.Corners.width); writer.Put(detection.Corners.height);
+					writer.Put<int32_t>(detection.Class);
+					writer.Put(detection.Confidence);
+				}
+			}
+			writer.Put<uint16_t>(camera.ArucoIndicesStereo.size());
+			for (size_t tagidx = 0; tagidx < camera.ArucoIndicesStereo.size(); tagidx++)
+			{
+				writer.Put<int32_t>(camera.ArucoIndicesStereo[tagidx]);
+				const auto &corners = camera.ArucoCornersStereo[tagidx];
+				writer.Put<uint8_t>(corners.size());
+				for (const Point3d &corner : corners)
+				{
+					writer.Put(corner.x); writer.Put(corner.y); writer.Put(corner.z);
+				}
+			}
+		}
+		writer.Put<uint32_t>(Objects.size());
+		for (const ObjectData &object : Objects)
+		{
+			writer.PutObject(object);
+		}
+	}
+
+	bool Deserialise(const uint8_t* Data, size_t Length, FeatureLog::Tick &OutTick)
+	{
+		ByteReader reader(Data, Length);
+		OutTick.Time = reader.GetTime();
+		OutTick.Team = (CDFRTeam)reader.Get<uint8_t>();
+		OutTick.Features.resize(reader.GetCount<uint16_t>(4 + 8 + 8 + sizeof(Matx44d)));
+		for (CameraFeatureData &camera : OutTick.Features)
+		{
+			camera.Clear();
+			camera.CameraName = reader.GetString();
+			camera.GrabTime = reader.GetTime();
+			camera.FrameSize.width = reader.Get<int32_t>();
+			camera.FrameSize.height = reader.Get<int32_t>();
+			camera.WorldToCamera = reader.GetAffine();
+			camera.ArucoSegments.resize(reader.GetCount<uint16_t>(4*4));
+			for (Rect &segment : camera.ArucoSegments)
+			{
+				segment = reader.GetRect();
+			}
+			camera.Lenses.resize(reader.GetCount<uint16_t>(2*sizeof(Matx44d)));
+			for (LensFeatureData &lens : camera.Lenses)
+			{
+				lens.Clear();
+				lens.CameraToLens = reader.GetAffine();
+				lens.WorldToLens = reader.GetAffine();
+				lens.CameraMatrix = reader.GetMat();
+				lens.ProjectionMatrix = reader.GetMat();
+				lens.DistanceCoefficients = reader.GetMat();
+				lens.ROI = reader.GetRect();
+				size_t NumTags = reader.GetCount<uint16_t>(4 + 1 + 1);
+				lens.ArucoIndices.resize(NumTags);
+				lens.StereoReprojected.resize(NumTags);
+				lens.ArucoCorners.resize(NumTags);
+				lens.ArucoCornersReprojected.resize(NumTags);
+				for (size_t tagidx = 0; tagidx < NumTags && !reader.Failed; tagidx++)
+				{
+					lens.ArucoIndices[tagidx] = reader.Get<int32_t>();
+					lens.StereoReprojected[tagidx] = reader.Get<uint8_t>();
+					lens.ArucoCorners[tagidx].resize(reader.GetCount<uint8_t>(2*sizeof(float)));
+					for (Point2f &corner : lens.ArucoCorners[tagidx])
+					{
+						corner.x = reader.Get<float>();
+						corner.y = reader.Get<float>();
+					}
+				}
+				lens.YoloDetections.resize(reader.GetCount<uint16_t>(6*4));
+				for (YoloDetection &detection : lens.YoloDetections)
+				{
+					detection.Corners.x = reader.Get<float>(); detection.Corners.y = reader.Get<float>();
+					detection.Corners.width = reader.Get<float>(); detection.Corners.height = reader.Get<float>();
+					detection.Class = reader.Get<int32_t>();
+					detection.Confidence = reader.Get<float>();
+				}
+			}
+			size_t NumStereo = reader.GetCount<uint16_t>(4 + 1);
+			camera.ArucoIndicesStereo.resize(NumStereo);
+			camera.ArucoCornersStereo.resize(NumStereo);
+			for (size_t tagidx = 0; tagidx < NumStereo && !reader.Failed; tagidx++)
+			{
+				camera.ArucoIndicesStereo[tagidx] = reader.Get<int32_t>();
+				camera.ArucoCornersStereo[tagidx].resize(reader.GetCount<uint8_t>(3*sizeof(double)));
+				for (Point3d &corner : camera.ArucoCornersStereo[tagidx])
+				{
+					corner.x = reader.Get<double>(); corner.y = reader.Get<double>(); corner.z = reader.Get<double>();
+				}
+			}
+			camera.Depth.reset();
+			if (reader.Failed)
+			{
+				return false;
+			}
+		}
+		OutTick.Objects.resize(reader.GetCount<uint32_t>(ByteReader::MinObjectSize));
+		for (ObjectData &object : OutTick.Objects)
+		{
+			object = reader.GetObject();
+			if (reader.Failed)
+			{
+				return false;
+			}
+		}
+		return !reader.Failed;
+	}
+}
+
+namespace FeatureLog
+{
+	Writer::~Writer()
+	{
+		Close();
+	}
+
+	bool Writer::Open(filesystem::path Path)
+	{
+		Close();
+		filesystem::create_directories(Path.parent_path());
+		File.open(Path, ios::binary | ios::trunc);
+		if (!File.is_open())
+		{
+			cerr << "Failed to open feature log " << Path << endl;
+			return false;
+		}
+		File.write((const char*)Magic, sizeof(Magic));
+		File.write((const char*)&Version, sizeof(Version));
+		Queue = make_unique<BoundedQueue<vector<uint8_t>>>(256);
+		Thread = make_unique<thread>(&Writer::ThreadEntryPoint, this);
+		cout << "Logging features to " << Path << endl;
+		return true;
+	}
+
+	void Writer::Write(chrono::steady_clock::time_point Time, CDFRTeam Team, 
+		const vector<CameraFeatureData> &Features, const vector<ObjectData> &Objects)
+	{
+		if (!Thread)
+		{
+			return;
+		}
+		vector<uint8_t> Buffer;
+		Serialise(Time, Team, Features, Objects, Buffer);
+		Queue->Push(move(Buffer));
+	}
+
+	void Writer::Close()
+	{
+		if (!Thread)
+		{
+			return;
+		}
+		Queue->Close();
+		Thread->join();
+		Thread.reset();
+		File.close();
+	}
+
+	void Writer::ThreadEntryPoint()
+	{
+		SetThreadName("Feature log");
+		while (true)
+		{
+			auto Buffer = Queue->Pop();
+			if (!Buffer.has_value())
+			{
+				break;
+			}
+			uint32_t Length = Buffer->size();
+			File.write((const char*)&Length, sizeof(Length));
+			File.write((const char*)Buffer->data(), Length);
+		}
+		File.flush();
+	}
+
+	bool Reader::Open(filesystem::path Path)
+	{
+		File.open(Path, ios::binary);
+		if (!File.is_open())
+		{
+			cerr << "Failed to open feature log " << Path << endl;
+			return false;
+		}
+		uint8_t ReadMagic[4];
+		uint16_t ReadVersion = 0;
+		File.read((char*)ReadMagic, sizeof(ReadMagic));
+		File.read((char*)&ReadVersion, sizeof(ReadVersion));
+		if (!File || memcmp(ReadMagic, Magic, sizeof(Magic)) != 0 || ReadVersion != Version)
+		{
+			cerr << "Feature log " << Path << " has an invalid header" << endl;
+			File.close();
+			return false;
+		}
+		return true;
+	}
+
+	bool Reader::Next(Tick &OutTick)
+	{
+		uint32_t Length = 0;
+		if (!File.read((char*)&Length, sizeof(Length)))
+		{
+			return false;
+		}
+		Buffer.resize(Length);
+		if (!File.read((char*)Buffer.data(), Length))
+		{
+			cerr << "Feature log ends with a truncated tick" << endl;
+			return false;
+		}
+		if (!Deserialise(Buffer.data(), Length, OutTick))
+		{
+			cerr << "Feature log has a corrupted tick" << endl;
+			return false;
+		}
+		return true;
+	}
+}
@@ -10,7 +10,6 @@
 #include <Misc/math2d.hpp>
 #include <Misc/GlobalConf.hpp>
 #include <Misc/MatToJSON.hpp>
-#include <Transport/thread-rename.hpp>
 
 #include <opencv2/imgcodecs.hpp>
 #include <libbase64.h>
@@ -19,6 +18,8 @@
 #include <iostream>
 #include <fstream>
 #include <set>
+#include <cstring>
+#include <cstddef>
 
 using namespace std;
 using namespace nlohmann;
@@ -28,13 +29,18 @@ JsonListener::JsonListener(shared_ptr<ConnectionToken> InToken, TCPJsonHost* InP
 {
 	LastAliveSent = chrono::steady_clock::now();
 	LastAliveReceived = LastAliveSent;
-	Start();
-	//cout << "Json listen thread for " << token->GetConnectionName() << " started" << endl;
+	if (!token)
+	{
+		killed = true;
+	}
 }
 
 JsonListener::~JsonListener()
 {
-	//cout << "Json listen thread for " << token->GetConnectionName() << " stoppped" << endl;
+	if (token)
+	{
+		token->Disconnect();
+	}
 }
 
 string JsonListener::JavaCapitalize(string source)
@@ -188,8 +194,9 @@ bool JsonListener::GetData(const json &Query, json &Response)
 	}
 	ObjectData::TimePoint OldCutoff = GetCutoffTime(Query);
 	 
-	vector<CameraFeatureData> FeatureData = Parent->ExternalRunner->GetFeatureData();
-	vector<ObjectData> ObjData = Parent->ExternalRunner->GetObjectData();
+	auto Snapshot = Parent->ExternalRunner->GetSnapshot();
+	const vector<CameraFeatureData> &FeatureData = Snapshot->FeatureData;
+	const vector<ObjectData> &ObjData = Snapshot->ObjData;
 	set<ObjectType> AllowedTypes = GetFilterClasses(QueryData.at("filters"));
 
 	json jsondataarray = json::array({});
@@ -282,6 +289,190 @@ bool JsonListener::GetData(const json &Query, json &Response)
 	return true;
 }
 
+bool JsonListener::Subscribe(const json &Query, json &Response)
+{
+	if (!Query.contains("data"))
+	{
+		return false;
+	}
+	auto &QueryData = Query.at("data");
+	if (!QueryData.contains("filters") || !QueryData.at("filters").is_array())
+	{
+		return false;
+	}
+	Subscription sub;
+	sub.Active = true;
+	sub.AllowedTypes = GetFilterClasses(QueryData.at("filters"));
+	sub.MaxAge = chrono::milliseconds(QueryData.value("maxAge", 0));
+	sub.Delta = QueryData.value("delta", false);
+	sub.KeyframeInterval = max(1, QueryData.value("keyframe", sub.KeyframeInterval));
+	sub.PositionThreshold = max(0.f, QueryData.value("threshold", 0.f));
+	sub.AgeThreshold = max(0, QueryData.value("ageThreshold", (int)sub.AgeThreshold));
+	Subscribed = sub;
+	Response["status"] = "OK";
+	Response["data"]["version"] = BinaryStream::Version;
+	TransformMode mode = ObjectMode;
+	Response["data"]["mode"] = TransformModeNames.at(mode == TransformMode::Millimeter2D ? mode : TransformMode::Float2D);
+	return true;
+}
+
+uint32_t JsonListener::GetSubscriptionId(uint32_t NameHash, const BinaryStream::ObjectRecord &Record, const map<uint32_t, Subscription::SentObject> &Current) const
+{
+	//Names are not unique for every object type (yolo classes...) : keep the id of the closest object of the same name sent last frame
+	optional<uint32_t> closest;
+	float closestdist = INFINITY;
+	for (auto &[id, sent] : Subscribed.LastSent)
+	{
+		if (sent.NameHash != NameHash || Current.find(id) != Current.end())
+		{
+			continue;
+		}
+		float dist = hypot(sent.Record.X - Record.X, sent.Record.Y - Record.Y);
+		if (dist < closestdist)
+		{
+			closest = id;
+			closestdist = dist;
+		}
+	}
+	if (closest.has_value())
+	{
+		return *closest;
+	}
+	//new object, probe for an id that is neither used this frame nor was last frame
+	uint32_t id = NameHash;
+	while (Current.find(id) != Current.end() || Subscribed.LastSent.find(id) != Subscribed.LastSent.end())
+	{
+		id++;
+	}
+	return id;
+}
+
+bool JsonListener::PushSubscription()
+{
+	unique_lock lock(SendMutex);
+	if (!Subscribed.Active || !Parent || !Parent->ExternalRunner)
+	{
+		return false;
+	}
+	if (Parent->ExternalRunner->GetSnapshotSequence() == Subscribed.LastSequence)
+	{
+		return false;
+	}
+	auto Snapshot = Parent->ExternalRunner->GetSnapshot();
+	if (Snapshot->Sequence == Subscribed.LastSequence)
+	{
+		return false;
+	}
+	Subscribed.LastSequence = Snapshot->Sequence;
+
+	bool Millimeter = ObjectMode == TransformMode::Millimeter2D;
+	bool Keyframe = !Subscribed.Delta || Subscribed.FramesSinceKeyframe >= Subscribed.KeyframeInterval;
+	Subscribed.FramesSinceKeyframe = Keyframe ? 1 : Subscribed.FramesSinceKeyframe+1;
+	bool has3D = Subscribed.AllowedTypes.find(ObjectType::Data3D) != Subscribed.AllowedTypes.end();
+	auto now = ObjectData::Clock::now();
+
+	map<uint32_t, Subscription::SentObject> Current;
+	vector<BinaryStream::ObjectRecord> Records;
+	vector<uint32_t> Removed;
+	for (auto &Object : Snapshot->ObjData)
+	{
+		if (!has3D && Subscribed.AllowedTypes.find(Object.type) == Subscribed.AllowedTypes.end())
+		{
+			continue;
+		}
+		if (Subscribed.MaxAge > ObjectData::Clock::duration::zero() && now - Object.LastSeen > Subscribed.MaxAge)
+		{
+			continue;
+		}
+		if (!ObjectTypeNames.at(Object.type).Sendable)
+		{
+			continue;
+		}
+		BinaryStream::ObjectRecord record{};
+		record.Type = (uint16_t)Object.type;
+		auto pos = Object.GetPos2D();
+		double rotZ = GetRotZ(Object.location.rotation());
+		if (Millimeter)
+		{
+			record.X = round(pos[0]*1000.0+1500.0);
+			record.Y = round(pos[1]*1000.0+1000.0);
+			record.R = round(rotZ*180.0/M_PI);
+		}
+		else
+		{
+			record.X = pos[0];
+			record.Y = pos[1];
+			record.R = rotZ;
+		}
+		record.Age = max<int64_t>(0, chrono::duration_cast<chrono::milliseconds>(now - Object.LastSeen).count());
+		uint32_t NameHash = BinaryStream::HashName(Object.name);
+		record.Id = GetSubscriptionId(NameHash, record, Current);
+		Subscription::SentObject &sent = Current[record.Id];
+		sent.Record = record;
+		sent.NameHash = NameHash;
+		if (Keyframe)
+		{
+			Records.push_back(record);
+			continue;
+		}
+		auto previous = Subscribed.LastSent.find(record.Id);
+		if (previous != Subscribed.LastSent.end())
+		{
+			const auto &prevrecord = previous->second.Record;
+			float threshold = Subscribed.PositionThreshold;
+			//the age of an object seen every tick barely moves, only resend it once it's noticeably older
+			bool changed = prevrecord.Type != record.Type || abs((int64_t)record.Age - (int64_t)prevrecord.Age) > Subscribed.AgeThreshold
+				|| abs(prevrecord.X - record.X) > threshold || abs(prevrecord.Y - record.Y) > threshold 
+				|| abs(prevrecord.R - record.R) > threshold;
+			if (!changed)
+			{
+				//keep what the client knows, so small moves can't accumulate without being sent
+				sent = previous->second;
+				continue;
+			}
+		}
+		Records.push_back(record);
+	}
+	if (!Keyframe)
+	{
+		for (auto &[id, sent] : Subscribed.LastSent)
+		{
+			if (Current.find(id) == Current.end())
+			{
+				Removed.push_back(id);
+			}
+		}
+	}
+	Subscribed.LastSent = move(Current);
+
+	size_t NumRecords = min<size_t>(Records.size(), UINT16_MAX);
+	size_t NumRemoved = min<size_t>(Removed.size(), UINT16_MAX);
+	BinaryStream::FrameHeader header{};
+	copy(begin(BinaryStream::Magic), end(BinaryStream::Magic), header.Magic);
+	header.Version = BinaryStream::Version;
+	header.Flags = (Keyframe ? 0 : BinaryStream::Delta) | (Millimeter ? BinaryStream::Millimeter : 0);
+	header.Sequence = Snapshot->Sequence;
+	header.Count = NumRecords;
+	header.Removed = NumRemoved;
+	size_t FrameSize = sizeof(header) + NumRecords*sizeof(BinaryStream::ObjectRecord) + NumRemoved*sizeof(uint32_t);
+	header.Length = FrameSize - offsetof(BinaryStream::FrameHeader, Length) - sizeof(header.Length);
+
+	vector<char> SendBuffer(FrameSize);
+	char* writeptr = SendBuffer.data();
+	memcpy(writeptr, &header, sizeof(header));
+	writeptr += sizeof(header);
+	memcpy(writeptr, Records.data(), NumRecords*sizeof(BinaryStream::ObjectRecord));
+	writeptr += NumRecords*sizeof(BinaryStream::ObjectRecord);
+	memcpy(writeptr, Removed.data(), NumRemoved*sizeof(uint32_t));
+
+	if (!token->IsConnected() || !token->Send(SendBuffer.data(), SendBuffer.size()))
+	{
+		cerr << "Failed to push subscription frame to " << token->GetConnectionName() << ", closing..." << endl;
+		killed = true;
+	}
+	return true;
+}
+
 bool JsonListener::GetZone(const json &Query, json &Response)
 {
 	if (!Query.contains("data"))
@@ -314,7 +505,8 @@ bool JsonListener::GetZone(const json &Query, json &Response)
 		AllowedTypes = GetFilterClasses(QueryData.at("classes"));
 	}
 	
-	auto ObjData = Parent->ExternalRunner->GetObjectData();
+	auto Snapshot = Parent->ExternalRunner->GetSnapshot();
+	const auto &ObjData = Snapshot->ObjData;
 
 	vector<pair<string, cv::Rect2d>> PositionFilters;
 	for (auto &elem : QueryData.at("zones"))
@@ -389,7 +581,8 @@ bool JsonListener::GetImage(double reduction, json &Response)
 	{
 		return false;
 	}
-	auto cameras = Parent->ExternalRunner->GetImage();
+	auto Snapshot = Parent->ExternalRunner->GetSnapshot();
+	const auto &cameras = Snapshot->ImageData;
 	Response["data"]["cameras"] = json::array({});
 	for (size_t i = 0; i < cameras.size(); i++)
 	{
@@ -432,7 +625,8 @@ bool JsonListener::GetStartingZone(const nlohmann::json query, nlohmann::json &r
 			return false;
 		}
 	}
-	auto data = Parent->ExternalRunner->GetObjectData();
+	auto Snapshot = Parent->ExternalRunner->GetSnapshot();
+	const auto &data = Snapshot->ObjData;
 	ObjectData robot;
 	robot.LastSeen = ObjectData::TimePoint();
 	for (auto &&i : data)
@@ -678,6 +872,25 @@ void JsonListener::HandleQuery(const json &Query)
 			}
 			goto send;
 		}
+		if (ActionStr == "SUBSCRIBE") //{"action":"SUBSCRIBE","data":{"filters":["ALL"],"delta":true}}
+		{
+			//Hold the stream until the response is out, so no frame is sent before it
+			unique_lock lock(SendMutex);
+			if(!Subscribe(Query, Response))
+			{
+				Response["status"] = "ERROR";
+			}
+			SendJson(Response);
+			return;
+		}
+		if (ActionStr == "UNSUBSCRIBE")
+		{
+			unique_lock lock(SendMutex);
+			Subscribed = Subscription();
+			Response["status"] = "OK";
+			SendJson(Response);
+			return;
+		}
 		if (ActionStr == "ZONE") //Get if zone empty or not
 		{
 			if(GetZone(Query, Response))
@@ -771,7 +984,6 @@ void JsonListener::HandleJson(const string &command)
 	{
 		return;
 	}
-	LastAliveReceived = chrono::steady_clock::now();
 	if (IsQuery(parsed))
 	{
 		cout << "Received action : " << command << endl;
@@ -787,6 +999,7 @@ void JsonListener::SendJson(const json &object)
 {
 	string SendBuffer = object.dump() + "\n";
 
+	unique_lock lock(SendMutex);
 	if (!token->IsConnected())
 	{
 		killed = true;
@@ -814,6 +1027,7 @@ void JsonListener::CheckAlive()
 	if (settings.poke_delay > 0 && TimeSinceLastAliveReceived.count() > settings.poke_delay && TimeSinceLastAliveSent.count() > settings.poke_delay)
 	{
 		LastAliveSent = chrono::steady_clock::now();
+		unique_lock lock(SendMutex);
 		if (!token->IsConnected())
 		{
 			killed = true;
@@ -827,63 +1041,94 @@ void JsonListener::CheckAlive()
 	}
 }
 
-void JsonListener::ThreadEntryPoint()
+bool JsonListener::Poll()
 {
-	if (!token)
+	if (killed)
+	{
+		return false;
+	}
+	if (!token->IsConnected())
 	{
 		killed = true;
-		return;
+		return false;
 	}
-	auto transport = token->GetParent();
-	if (!transport)
+	CheckAlive();
+	bool Activity = PushSubscription();
+	//queries that couldn't be handed to a dispatcher last time
+	SchedulePendingQueries();
+
+	auto [writeptr, writesize] = ReceiveBuffer.GetWriteArea();
+	if (writesize == 0)
+	{
+		cerr << "Client " << token->GetConnectionName() << " sent a line longer than the receive buffer, dropping it" << endl;
+		ReceiveBuffer.Clear();
+		tie(writeptr, writesize) = ReceiveBuffer.GetWriteArea();
+	}
+	auto numreceived = token->Receive(writeptr, writesize);
+	if (!numreceived.has_value())
 	{
 		killed = true;
-		return;
+		return Activity;
 	}
-	string ThreadName = string("Json ") + token->GetConnectionName();
-	SetThreadName(ThreadName.c_str());
-	while (!killed && token->IsConnected())
+	if (numreceived.value() == 0)
 	{
-		CheckAlive();
+		return Activity;
+	}
+	ReceiveBuffer.Commit(numreceived.value());
 
-		array<char, 1<<10> bufferraw;
-		auto numreceived = token->Receive(bufferraw.data(), bufferraw.size());
-		if (!numreceived.has_value())
+	{
+		unique_lock lock(QueryMutex);
+		while (auto line = ReceiveBuffer.NextLine())
 		{
-			killed = true;
-			break;
-		} else if (numreceived.value() == 0) {
-			this_thread::sleep_for(chrono::microseconds(500));
+			if (line->size() < 3)
+			{
+				continue;
+			}
+			LastAliveReceived = chrono::steady_clock::now();
+			PendingQueries.emplace_back(*line);
 		}
-		int rcvbufstartpos = 0;
-		int rcvbufinsertpos = ReceiveBuffer.size();
+	}
+	SchedulePendingQueries();
+	return true;
+}
 
-		ReceiveBuffer.insert(ReceiveBuffer.end(), bufferraw.data(), bufferraw.data() + numreceived.value());
+void JsonListener::SchedulePendingQueries()
+{
+	{
+		unique_lock lock(QueryMutex);
+		if (PendingQueries.size() == 0 || Scheduled)
+		{
+			return;
+		}
+		Scheduled = true;
+	}
+	if (!Parent->ScheduleQueries(shared_from_this()))
+	{
+		//no dispatcher owns them, the next poll tries again
+		unique_lock lock(QueryMutex);
+		Scheduled = false;
+	}
+}
 
-		for (size_t i = rcvbufinsertpos; i < ReceiveBuffer.size(); i++)
+void JsonListener::RunPendingQueries()
+{
+	while (true)
+	{
+		string command;
 		{
-			if (ReceiveBuffer[i] != '\n')
+			unique_lock lock(QueryMutex);
+			if (killed)
 			{
-				continue;
-			}
-			int commandlen = i-rcvbufstartpos-1;
-			if (commandlen<2)
-			{
-
+				PendingQueries.clear();
 			}
-			else
+			if (PendingQueries.size() == 0)
 			{
-				string command(ReceiveBuffer.begin() + rcvbufstartpos, ReceiveBuffer.begin() + i);
-				HandleJson(command);
+				Scheduled = false;
+				return;
 			}
-			rcvbufstartpos=i+1;
-		}
-		rcvbufstartpos = min<int>(ReceiveBuffer.size(), rcvbufstartpos);
-		if (rcvbufstartpos != 0)
-		{
-			ReceiveBuffer.erase(ReceiveBuffer.begin(), ReceiveBuffer.begin()+rcvbufstartpos);
+			command = move(PendingQueries.front());
+			PendingQueries.pop_front();
 		}
+		HandleJson(command);
 	}
-	token->Disconnect();
-	killed = true;
-}
\ No newline at end of file
+}
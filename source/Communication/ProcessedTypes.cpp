@@ -38,4 +38,5 @@ void CameraFeatureData::CopyEssentials(const CameraImageData &source)
 		feat.ROI = lens.ROI;
 	}
 	FrameSize = source.Image.size();
+	GrabTime = source.GrabTime;
 }
\ No newline at end of file
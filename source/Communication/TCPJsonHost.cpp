@@ -18,41 +18,104 @@ void TCPJsonHost::ThreadEntryPoint(optional<GenericTransport::NetworkInterface>
 	
 	unique_ptr<TCPTransport> Transport = make_unique<TCPTransport>(true, "0.0.0.0", Port, interface.has_value() ? interface.value().name : "");
 	set<shared_ptr<JsonListener>> Listeners;
+	chrono::steady_clock::time_point LastAccept;
+	chrono::microseconds IdleWait = MinIdleWait;
+	chrono::steady_clock::time_point LastActivity;
 	while (!killed)
 	{
-		auto newconnections = Transport->AcceptNewConnections();
-		for (auto &&connection : newconnections)
+		auto now = chrono::steady_clock::now();
+		if (now - LastAccept > AcceptInterval)
 		{
-			JsonListener* listener = new JsonListener(connection, this);
-			Listeners.emplace(listener);
-			NumClients++;
-			ExternalRunner->SetHasNoClients(NumClients == 0);
-			cout << NumClients << " clients right now" << endl;
-		}
-		for (auto it = Listeners.begin(); it != Listeners.end();)
-		{
-			shared_ptr<JsonListener> lptr = *it;
-			if (lptr->IsKilled())
+			LastAccept = now;
+			auto newconnections = Transport->AcceptNewConnections();
+			for (auto &&connection : newconnections)
 			{
-				cout << "Client at " << lptr->token->GetConnectionName() << " is killed, cleaning..." << endl;
-				it=Listeners.erase(it);
-				NumClients--;
+				Listeners.emplace(make_shared<JsonListener>(connection, this));
+				LastActivity = now;
+				NumClients++;
 				ExternalRunner->SetHasNoClients(NumClients == 0);
 				cout << NumClients << " clients right now" << endl;
 			}
-			else
+			for (auto it = Listeners.begin(); it != Listeners.end();)
 			{
-				it++;
+				shared_ptr<JsonListener> lptr = *it;
+				if (lptr->IsKilled())
+				{
+					cout << "Client at " << lptr->token->GetConnectionName() << " is killed, cleaning..." << endl;
+					it=Listeners.erase(it);
+					NumClients--;
+					ExternalRunner->SetHasNoClients(NumClients == 0);
+					cout << NumClients << " clients right now" << endl;
+				}
+				else
+				{
+					it++;
+				}
 			}
 		}
-		
-		this_thread::sleep_for(chrono::milliseconds(100));
+
+		uint64_t Sequence = ExternalRunner ? ExternalRunner->GetSnapshotSequence() : 0;
+		bool Activity = false;
+		for (auto &listener : Listeners)
+		{
+			Activity |= listener->Poll();
+		}
+		if (Activity)
+		{
+			LastActivity = now;
+			IdleWait = MinIdleWait;
+			continue;
+		}
+		//nobody to poll, only new connections can wake us up
+		chrono::microseconds Wait = Listeners.empty() ? chrono::duration_cast<chrono::microseconds>(AcceptInterval) : IdleWait;
+		bool NewSnapshot = false;
+		if (ExternalRunner)
+		{
+			NewSnapshot = ExternalRunner->WaitForSnapshot(Sequence, Wait);
+		}
+		else
+		{
+			this_thread::sleep_for(Wait);
+		}
+		if (NewSnapshot)
+		{
+			//the queries for the new data are about to come
+			IdleWait = MinIdleWait;
+		}
+		else
+		{
+			IdleWait = min(IdleWait*2, now - LastActivity > QuietAfter ? QuietIdleWait : ActiveIdleWait);
+		}
+	}
+}
+
+bool TCPJsonHost::ScheduleQueries(shared_ptr<JsonListener> Listener)
+{
+	//the reactor calls this, blocking here would stall every client
+	return ScheduledListeners.TryPush(Listener);
+}
+
+void TCPJsonHost::DispatchEntryPoint()
+{
+	SetThreadName("Json dispatch");
+	while (!killed)
+	{
+		auto listener = ScheduledListeners.Pop();
+		if (!listener.has_value())
+		{
+			break;
+		}
+		listener.value()->RunPendingQueries();
 	}
 }
 
 TCPJsonHost::TCPJsonHost(int InPort)
-	:Port(InPort)
+	:ScheduledListeners(256), Port(InPort)
 {
+	for (int i = 0; i < NumDispatchers; i++)
+	{
+		Dispatchers.emplace_back(make_unique<thread>(&TCPJsonHost::DispatchEntryPoint, this));
+	}
 	auto interfaces = GenericTransport::GetInterfaces();
 	#if 0
 	for (size_t i=0; i<interfaces.size(); i++)
@@ -77,4 +140,10 @@ TCPJsonHost::~TCPJsonHost()
 	{
 		thread->join();
 	}
+	ScheduledListeners.Clear();
+	ScheduledListeners.Close();
+	for (auto &thread : Dispatchers)
+	{
+		thread->join();
+	}
 }
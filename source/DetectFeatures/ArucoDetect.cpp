@@ -9,6 +9,7 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/imgcodecs.hpp> //for debug
 #include <random>
+#include <mutex>
 
 #include <Misc/math2d.hpp>
 #include <Misc/math3d.hpp>
@@ -21,10 +22,12 @@ using namespace std;
 
 const auto dict = aruco::getPredefinedDictionary(aruco::DICT_4X4_100);
 unique_ptr<aruco::ArucoDetector> GlobalDetector, POIDetector;
+mutex DetectorsMutex; //camera workers may all try to create the detectors on their first frame
 
 void MakeDetectors()
 {
 	const int adaptiveThreshConstant = 20;
+	unique_lock lock(DetectorsMutex);
 	if (!GlobalDetector.get())
 	{
 		auto params = aruco::DetectorParameters();
@@ -83,15 +86,164 @@ UMat PreprocessArucoImage(UMat Source)
 	}
 }
 
-Point2f ComputeMean(const ArucoCornerArray &Points)
+namespace
 {
-	Point2f mean(0,0);
-	for (size_t j = 0; j < Points.size(); j++)
+	//Merges the detections of the overlapping segments of a lens : a tag seen by several segments is averaged into one detection
+	//Detections are hashed by id and by the cell of their center, so each one is only compared to the few close ones with the same id
+	//Corners are summed in a flat array and only divided once for the detections that were merged
+	class ArucoSegmentMerger
 	{
-		mean += Points[j];
-	}
-	mean /= (int)Points.size();
-	return mean;
+	private:
+		static constexpr size_t NumCorners = 4;
+		//Centers closer than half of this are the same tag
+		static constexpr float SameWindowSize = 4;
+		//Merged centers drift a bit from where they were hashed, the cells are larger than the window to cover it
+		static constexpr float CellSize = SameWindowSize*2;
+		static constexpr uint64_t EmptyKey = UINT64_MAX;
+
+		vector<Point2f> CornerSums; //NumCorners per detection
+		vector<int> Counts;
+		vector<int> NextInCell; //next detection with the same key, -1 at the end
+		//open addressing table of key -> first detection with that key
+		vector<uint64_t> TableKeys;
+		vector<int> TableHeads;
+		int TableBits = 0;
+
+		static Point2i GetCell(Point2f Center)
+		{
+			return Point2i(floor(Center.x/CellSize), floor(Center.y/CellSize));
+		}
+
+		static uint64_t GetKey(int Id, Point2i Cell)
+		{
+			const uint32_t Bias = 1<<23;
+			return ((uint64_t)(uint16_t)Id << 48) 
+				| ((uint64_t)((Cell.x + Bias) & 0xFFFFFF) << 24) 
+				| (uint64_t)((Cell.y + Bias) & 0xFFFFFF);
+		}
+
+		size_t GetSlot(uint64_t Key) const
+		{
+			size_t slot = (Key * 0x9E3779B97F4A7C15ull) >> (64 - TableBits);
+			size_t mask = TableKeys.size() - 1;
+			while (TableKeys[slot] != Key && TableKeys[slot] != EmptyKey)
+			{
+				slot = (slot + 1) & mask;
+			}
+			return slot;
+		}
+
+		static Point2f GetCenter(const ArucoCornerArray &Corners)
+		{
+			Point2f sum(0,0);
+			for (const Point2f &corner : Corners)
+			{
+				sum += corner;
+			}
+			return sum / (float)Corners.size();
+		}
+
+		Point2f GetCenter(int Index) const
+		{
+			Point2f sum(0,0);
+			for (size_t i = 0; i < NumCorners; i++)
+			{
+				sum += CornerSums[Index*NumCorners + i];
+			}
+			return sum / (float)(NumCorners * Counts[Index]);
+		}
+
+	public:
+		//Empties the merger, and sizes it so that adding MaxDetections doesn't allocate
+		void Reset(size_t MaxDetections)
+		{
+			CornerSums.clear();
+			CornerSums.reserve(MaxDetections * NumCorners);
+			Counts.clear();
+			Counts.reserve(MaxDetections);
+			NextInCell.clear();
+			NextInCell.reserve(MaxDetections);
+			//at most half full
+			TableBits = 4;
+			while (((size_t)1 << TableBits) < MaxDetections * 2)
+			{
+				TableBits++;
+			}
+			TableKeys.assign((size_t)1 << TableBits, EmptyKey);
+			TableHeads.assign(TableKeys.size(), -1);
+		}
+
+		//Adds a detection without looking for one to merge it with, returns its index
+		int Insert(int Id, const ArucoCornerArray &Corners)
+		{
+			assert(Corners.size() == NumCorners);
+			int index = Counts.size();
+			CornerSums.insert(CornerSums.end(), Corners.begin(), Corners.end());
+			Counts.push_back(1);
+			uint64_t key = GetKey(Id, GetCell(GetCenter(Corners)));
+			size_t slot = GetSlot(key);
+			TableKeys[slot] = key;
+			NextInCell.push_back(TableHeads[slot]);
+			TableHeads[slot] = index;
+			return index;
+		}
+
+		//Merges the detection into the oldest one with the same id that is centered within the window, or adds it
+		//Returns true if it was merged, Index is then the detection it was merged into
+		bool Add(int Id, const ArucoCornerArray &Corners, int &Index)
+		{
+			const Rect2f SameThreshold(-SameWindowSize/2,-SameWindowSize/2,SameWindowSize,SameWindowSize);
+			Point2f center = GetCenter(Corners);
+			Point2i cell = GetCell(center);
+			int found = -1;
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					uint64_t key = GetKey(Id, cell + Point2i(dx, dy));
+					size_t slot = GetSlot(key);
+					if (TableKeys[slot] != key)
+					{
+						continue;
+					}
+					for (int other = TableHeads[slot]; other >= 0; other = NextInCell[other])
+					{
+						if ((found < 0 || other < found) && (center - GetCenter(other)).inside(SameThreshold))
+						{
+							found = other;
+						}
+					}
+				}
+			}
+			if (found < 0)
+			{
+				Index = Insert(Id, Corners);
+				return false;
+			}
+			for (size_t i = 0; i < NumCorners; i++)
+			{
+				CornerSums[found*NumCorners + i] += Corners[i];
+			}
+			Counts[found]++;
+			Index = found;
+			return true;
+		}
+
+		bool IsMerged(int Index) const
+		{
+			return Counts[Index] > 1;
+		}
+
+		//Mean of the corners merged into that detection
+		void GetCorners(int Index, ArucoCornerArray &OutCorners) const
+		{
+			OutCorners.resize(NumCorners);
+			for (size_t i = 0; i < NumCorners; i++)
+			{
+				OutCorners[i] = CornerSums[Index*NumCorners + i] / (float)Counts[Index];
+			}
+		}
+	};
 }
 
 int DetectArucoSegmented(CameraImageData InData, CameraFeatureData *OutData, const vector<vector<Rect>> &Segments, const aruco::ArucoDetector* Detector)
@@ -160,6 +312,7 @@ int DetectArucoSegmented(CameraImageData InData, CameraFeatureData *OutData, con
 	});
 	
 	int NumDetectionsTotal = 0;
+	ArucoSegmentMerger Merger;
 
 	for (size_t lensidx = 0; lensidx < InData.lenses.size(); lensidx++)
 	{
@@ -173,67 +326,36 @@ int DetectArucoSegmented(CameraImageData InData, CameraFeatureData *OutData, con
 			NumDetectionsThis += ids[lensidx][poiidx].size();
 		}
 		size_t MaxDetectionsAfter = NumDetectionsThis + NumDetectionsBefore;
-		vector<int> accumulations;
-		vector<Point2f> means;
-		accumulations.resize(NumDetectionsBefore, 1);
-		accumulations.reserve(MaxDetectionsAfter);
-		means.resize(NumDetectionsBefore, Point2f(0,0));
-		means.reserve(MaxDetectionsAfter);
+		Merger.Reset(MaxDetectionsAfter);
 		for (size_t i = 0; i < NumDetectionsBefore; i++)
 		{
-			means[i] = ComputeMean(lensDetections.ArucoCorners[i]);
+			Merger.Insert(lensDetections.ArucoIndices[i], lensDetections.ArucoCorners[i]);
 		}
-		const float SameWindowSize = 4;
-		const Rect2f SameThreshold(-SameWindowSize/2,-SameWindowSize/2,SameWindowSize,SameWindowSize);
 		lensDetections.ArucoCorners.reserve(MaxDetectionsAfter);
 		lensDetections.ArucoIndices.reserve(MaxDetectionsAfter);
 		lensDetections.ArucoCornersReprojected.reserve(MaxDetectionsAfter);
 		for (size_t poiidx = 0; poiidx < NumSegments; poiidx++)
 		{
-			
-			size_t numdetslocal = ids[lensidx][poiidx].size();
-			if (numdetslocal ==0)
-			{
-				continue;
-			}
 			vector<ArucoCornerArray> &CornersLocal = corners[lensidx][poiidx];
 			vector<int> &IDsLocal = ids[lensidx][poiidx];
-			for (size_t PotentialIdx = 0; PotentialIdx < numdetslocal; PotentialIdx++)
+			for (size_t PotentialIdx = 0; PotentialIdx < IDsLocal.size(); PotentialIdx++)
 			{
-				bool found = false;
-				Point2f mean = ComputeMean(CornersLocal[PotentialIdx]);
-				for (size_t PresentIdx = 0; PresentIdx < lensDetections.ArucoCorners.size(); PresentIdx++)
-				{
-					if (lensDetections.ArucoIndices[PresentIdx] != IDsLocal[PotentialIdx])
-					{
-						continue;
-					}
-					Point2f &meanother = means[PresentIdx];
-					Point2f diff = mean-meanother;
-					if (diff.inside(SameThreshold))
-					{
-						found = true;
-						//mean the mean
-						meanother = (meanother*accumulations[PresentIdx] + mean) / (accumulations[PresentIdx]+1);
-						for (size_t corneridx = 0; corneridx < lensDetections.ArucoCorners[PresentIdx].size(); corneridx++)
-						{
-							//mean the corner locations
-							lensDetections.ArucoCorners[PresentIdx][corneridx] = (lensDetections.ArucoCorners[PresentIdx][corneridx]*accumulations[PresentIdx] + CornersLocal[PotentialIdx][corneridx]) / (accumulations[PresentIdx]+1);
-						}
-						accumulations[PresentIdx]++;
-						//cout << "Merging aruco at " << mean << endl;
-						break;
-					}
-				}
-				if (found)
+				int index;
+				if (Merger.Add(IDsLocal[PotentialIdx], CornersLocal[PotentialIdx], index))
 				{
 					continue;
 				}
-				means.push_back(mean);
 				lensDetections.ArucoIndices.push_back(IDsLocal[PotentialIdx]);
-				lensDetections.ArucoCorners.push_back(CornersLocal[PotentialIdx]);
+				//the segment results are thrown away after this
+				lensDetections.ArucoCorners.push_back(std::move(CornersLocal[PotentialIdx]));
 				lensDetections.StereoReprojected.push_back(false);
-				accumulations.push_back(1);
+			}
+		}
+		for (size_t i = 0; i < lensDetections.ArucoCorners.size(); i++)
+		{
+			if (Merger.IsMerged(i))
+			{
+				Merger.GetCorners(i, lensDetections.ArucoCorners[i]);
 			}
 		}
 		lensDetections.ArucoCornersReprojected.resize(lensDetections.ArucoIndices.size());
@@ -398,6 +520,92 @@ int DetectArucoSegmented(CameraImageData InData, CameraFeatureData *OutData, int
 	return DetectArucoSegmented(InData, OutData, ROIs, GlobalDetector.get());
 }
 
+vector<Rect> GetTrackedArucoROIs(const LensFeatureData &LensData, Size LensSize, int MinROISize)
+{
+	vector<Rect> rois;
+	rois.reserve(LensData.ArucoCorners.size());
+	Rect bounds(Point(0,0), LensSize);
+	for (auto &corners : LensData.ArucoCorners)
+	{
+		//leave room for the tag to move by its own size between two frames
+		Rect box = boundingRect(corners);
+		int margin = max(max(box.width, box.height), MinROISize/2);
+		box.x -= margin;
+		box.y -= margin;
+		box.width += margin*2;
+		box.height += margin*2;
+		box &= bounds;
+		if (box.area() == 0)
+		{
+			continue;
+		}
+		rois.push_back(box);
+	}
+	//merge overlapping windows so that no pixel is searched twice
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (size_t i = 0; i < rois.size() && !merged; i++)
+		{
+			for (size_t j = i+1; j < rois.size(); j++)
+			{
+				if ((rois[i] & rois[j]).area() == 0)
+				{
+					continue;
+				}
+				rois[i] |= rois[j];
+				rois.erase(rois.begin()+j);
+				merged = true;
+				break;
+			}
+		}
+	}
+	return rois;
+}
+
+int DetectArucoTracked(CameraImageData InData, CameraFeatureData *OutData, ArucoTrackingState &State, int MaxArucoSize, Size Segments, int FullSweepInterval)
+{
+	assert(OutData != nullptr);
+	MakeDetectors();
+	size_t num_lenses = InData.lenses.size();
+	auto CountDetections = [OutData]()
+	{
+		int count = 0;
+		for (auto &lens : OutData->Lenses)
+		{
+			count += lens.ArucoIndices.size();
+		}
+		return count;
+	};
+
+	bool sweep = State.SweepDue(num_lenses, FullSweepInterval);
+	if (!sweep)
+	{
+		DetectArucoSegmented(InData, OutData, State.LastROIs, GlobalDetector.get());
+		State.FramesSinceSweep++;
+		//a tag went out of its window or disappeared, look everywhere to find it again
+		bool lost = CountDetections() < State.LastNumDetections;
+		bool partial = InData.ValidROIs.size() > 0;
+		sweep = lost && !partial;
+		State.ForceSweep = lost && partial;
+	}
+	if (sweep)
+	{
+		DetectArucoSegmented(InData, OutData, MaxArucoSize, Segments);
+		State.FramesSinceSweep = 0;
+		State.ForceSweep = false;
+	}
+
+	State.LastROIs.resize(num_lenses);
+	for (size_t lensidx = 0; lensidx < num_lenses; lensidx++)
+	{
+		State.LastROIs[lensidx] = GetTrackedArucoROIs(OutData->Lenses[lensidx], InData.lenses[lensidx].ROI.size(), 64);
+	}
+	State.LastNumDetections = CountDetections();
+	return State.LastNumDetections;
+}
+
 int DetectAruco(CameraImageData InData, CameraFeatureData *OutData)
 {
 	assert(OutData != nullptr);
@@ -0,0 +1,183 @@
+#include "DetectFeatures/ArucoGridTuner.hpp"
+
+#include <thread>
+#include <algorithm>
+#include <cmath>
+
+#include <Cameras/ImageTypes.hpp>
+
+using namespace std;
+using namespace cv;
+
+Size ArucoGridTuner::GetDefaultGrid(Size LensSize)
+{
+	Size NumArucoSegments = LensSize/800 + Size(1,1);
+	const auto processor_count = std::thread::hardware_concurrency();
+	if (NumArucoSegments.area() > processor_count && processor_count > 0)
+	{
+		double aspect_ratio = LensSize.aspectRatio();
+		NumArucoSegments.width = ceil(sqrt(processor_count) * aspect_ratio);
+		NumArucoSegments.height = ceil(sqrt(processor_count) / aspect_ratio);
+	}
+	return NumArucoSegments;
+}
+
+int ArucoGridTuner::ComputeOverlap(const CameraImageData &ImageData, Affine3d Location, double LargestTag) const
+{
+	double focal = 0;
+	for (const LensSettings &lens : ImageData.lenses)
+	{
+		if (lens.CameraMatrix.empty())
+		{
+			continue;
+		}
+		focal = max({focal, lens.CameraMatrix.at<double>(0,0), lens.CameraMatrix.at<double>(1,1)});
+	}
+	//closest a tag can be : on top of a robot, right under the camera
+	double distance = Location.translation()[2] - MaxTagHeight;
+	if (focal <= 0 || LargestTag <= 0 || distance < 0.1)
+	{
+		return DefaultOverlap;
+	}
+	//facing the camera, along its diagonal
+	double TagPixels = focal * LargestTag * M_SQRT2 / distance;
+	int MaxOverlap = min(LensSize.width, LensSize.height)/2;
+	return clamp<int>(ceil(TagPixels), MinOverlap, max(MinOverlap, MaxOverlap));
+}
+
+void ArucoGridTuner::Reset(Size InLensSize)
+{
+	LensSize = InLensSize;
+	Current = GetDefaultGrid(LensSize);
+	Best = Current;
+	SweepsOnBest = 0;
+	Timings.clear();
+}
+
+vector<Size> ArucoGridTuner::GetNeighbours(Size Grid) const
+{
+	const int processor_count = max<int>(1, std::thread::hardware_concurrency());
+	vector<Size> neighbours;
+	for (Size candidate : {Grid + Size(1,0), Grid - Size(1,0), Grid + Size(0,1), Grid - Size(0,1)})
+	{
+		if (candidate.width < 1 || candidate.height < 1 || candidate.area() > processor_count * MaxSegmentsPerCore)
+		{
+			continue;
+		}
+		//segments that are mostly overlap search the same pixels over and over
+		if (LensSize.width < (candidate.width+1) * Overlap || LensSize.height < (candidate.height+1) * Overlap)
+		{
+			continue;
+		}
+		neighbours.push_back(candidate);
+	}
+	return neighbours;
+}
+
+const ArucoGridTuner::GridTiming* ArucoGridTuner::GetTiming(Size Grid) const
+{
+	auto found = Timings.find({Grid.width, Grid.height});
+	if (found == Timings.end())
+	{
+		return nullptr;
+	}
+	return &found->second;
+}
+
+optional<Size> ArucoGridTuner::GetUnexplored(Size Grid) const
+{
+	for (Size neighbour : GetNeighbours(Grid))
+	{
+		const GridTiming* timing = GetTiming(neighbour);
+		if (!timing || timing->Samples < SamplesPerGrid)
+		{
+			return neighbour;
+		}
+	}
+	return nullopt;
+}
+
+Size ArucoGridTuner::GetFastest(Size Grid) const
+{
+	const GridTiming* best = GetTiming(Grid);
+	Size fastest = Grid;
+	for (Size neighbour : GetNeighbours(Grid))
+	{
+		const GridTiming* timing = GetTiming(neighbour);
+		//only move when it's clearly faster, the timings are noisy
+		if (timing && timing->Samples >= SamplesPerGrid && (!best || timing->Mean < best->Mean * (1.0 - Hysteresis)))
+		{
+			best = timing;
+			fastest = neighbour;
+		}
+	}
+	return fastest;
+}
+
+void ArucoGridTuner::Prepare(const CameraImageData &ImageData, Affine3d Location, double LargestTag)
+{
+	if (ImageData.lenses.empty())
+	{
+		return;
+	}
+	Size NewLensSize = ImageData.lenses[0].ROI.size();
+	if (NewLensSize != LensSize)
+	{
+		Reset(NewLensSize);
+		Overlap = 0;
+	}
+	int NewOverlap = ComputeOverlap(ImageData, Location, LargestTag);
+	//the location moves a bit every frame, only start over when the overlap really changes
+	if (Overlap == 0 || abs(NewOverlap - Overlap) > Overlap/4)
+	{
+		Overlap = NewOverlap;
+		Timings.clear();
+		Current = Best;
+		SweepsOnBest = 0;
+	}
+}
+
+void ArucoGridTuner::AddSweep(double Seconds)
+{
+	if (Current.area() == 0)
+	{
+		return;
+	}
+	GridTiming &timing = Timings[{Current.width, Current.height}];
+	timing.Samples++;
+	timing.Mean += (Seconds - timing.Mean) / min(timing.Samples, SamplesPerGrid);
+	if (timing.Samples < SamplesPerGrid)
+	{
+		return;
+	}
+	optional<Size> unexplored = GetUnexplored(Best);
+	if (unexplored.has_value())
+	{
+		Current = *unexplored;
+		return;
+	}
+	Size fastest = GetFastest(Best);
+	if (fastest != Best)
+	{
+		//its own neighbours get explored on the next sweeps
+		Best = fastest;
+		Current = Best;
+		SweepsOnBest = 0;
+		return;
+	}
+	Current = Best;
+	SweepsOnBest++;
+	if (SweepsOnBest < ProbeInterval)
+	{
+		return;
+	}
+	//time one of the neighbours again, it may have become faster
+	SweepsOnBest = 0;
+	vector<Size> neighbours = GetNeighbours(Best);
+	if (neighbours.empty())
+	{
+		return;
+	}
+	Current = neighbours[NextProbe++ % neighbours.size()];
+	Timings[{Current.width, Current.height}].Samples = 0;
+}
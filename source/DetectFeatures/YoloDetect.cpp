@@ -7,6 +7,7 @@
 #include <array>
 
 #include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
 #include <opencv2/highgui.hpp>
 
 #include <Misc/GlobalConf.hpp>
@@ -54,69 +55,144 @@ void YoloDetect::loadNet()
 		cout << "Backend " << backend.first << " is available with target " << backend.second << endl;
 	}
 	#endif
-	network = dnn::readNetFromDarknet(GetNetworkPath(".cfg"), GetNetworkPath(".weights"));
+	try
+	{
+		if (filesystem::exists(GetNetworkPath(".onnx")))
+		{
+			network = dnn::readNetFromONNX(GetNetworkPath(".onnx"));
+			NormalizedOutput = false;
+		}
+		else if (filesystem::exists(GetNetworkPath(".weights")))
+		{
+			network = dnn::readNetFromDarknet(GetNetworkPath(".cfg"), GetNetworkPath(".weights"));
+			NormalizedOutput = true;
+		}
+		else
+		{
+			cerr << "No network found for yolo model " << ModelName << " (looked for .onnx and .cfg/.weights in " << GetNetworkPath().parent_path() << ")" << endl;
+			return;
+		}
+	}
+	catch(const std::exception& e)
+	{
+		cerr << "Failed to load yolo model " << ModelName << " : " << e.what() << endl;
+		return;
+	}
+	NetworkLoaded = !network.empty();
 }
 
-void YoloDetect::Preprocess(const UMat& frame, Size inpSize, float scale, const Scalar& mean, bool swapRB)
+YoloDetect::Letterbox YoloDetect::Preprocess(const UMat& frame, Size inpSize, Mat &Letterboxed)
 {
-	Mat blob;
-	// Create a 4D blob from a frame.
-	if (inpSize.width <= 0) inpSize.width = frame.cols;
-	if (inpSize.height <= 0) inpSize.height = frame.rows;
-	dnn::blobFromImage(frame, blob, 1.0, inpSize, Scalar(), swapRB, false);
-	//cout << "Input has size " << blob.size << endl;
-	// Run a model.
-	network.setInput(blob, "", scale, mean);
+	//keep the aspect ratio, pad the rest with gray
+	Letterbox box;
+	box.Scale = min((double)inpSize.width/frame.cols, (double)inpSize.height/frame.rows);
+	Size scaledSize(round(frame.cols*box.Scale), round(frame.rows*box.Scale));
+	box.Offset = Point2d((inpSize.width-scaledSize.width)/2, (inpSize.height-scaledSize.height)/2);
+	Letterboxed.create(inpSize, CV_8UC3);
+	Letterboxed.setTo(Scalar::all(114));
+	Mat Target = Letterboxed(Rect(Point(box.Offset), scaledSize));
+	if (frame.channels() == 1)
+	{
+		Mat Scaled;
+		resize(frame, Scaled, scaledSize, 0, 0, INTER_AREA);
+		cvtColor(Scaled, Target, COLOR_GRAY2BGR);
+	}
+	else
+	{
+		resize(frame, Target, scaledSize, 0, 0, INTER_AREA);
+	}
+	return box;
 }
 
 
-vector<YoloDetect::Detection> YoloDetect::Postprocess(const vector<Mat> &outputBlobs, const vector<string> &layerNames, Rect window)
+vector<vector<YoloDetect::Detection>> YoloDetect::Postprocess(const vector<Mat> &outputBlobs, const vector<Letterbox> &Letterboxes, 
+	Size inpSize, int numclasses, bool NormalizedOutput)
 {
-	vector<Rect> boxes;
+	const float ConfidenceThreshold = 0.4, NMSThreshold = 0.5;
+	const int batchsize = Letterboxes.size();
+	vector<Rect2d> boxes;
 	vector<float> scores;
-	vector<vector<float>> classes;
-	int numclasses = ClassNames.size();
-	for (size_t blobidx = 0; blobidx < outputBlobs.size(); blobidx++)
-	{
-		auto& blob = outputBlobs[blobidx];
-		auto& layername = layerNames[blobidx];
-		(void) layername;
-		int numdet = 1;
-		for (int i = 0; i < blob.size.dims()-1; i++)
-		{
-			numdet*=blob.size[i];
-		}
-		int numelem = blob.size[blob.size.dims()-1];
-		assert(numelem == numclasses +4 +1); //x, y, width, height, confidence, classes...
-		//cout << "Layer " << layername << " has " << numdet << " detections and " << numelem << " elements/detection" << endl;
-		size_t newnum = boxes.size() + numdet;
-		boxes.reserve(newnum);
-		scores.reserve(newnum);
-		classes.reserve(newnum);
-		int stride = blob.elemSize1() * numelem;
-		assert(blob.elemSize1() == sizeof(float));
-		//cout << "stride is " << stride << " bytes/detection" << endl;
-		for (const uint8_t* ptr = blob.data; ptr < blob.dataend; ptr+=stride)
-		{
-			auto recast = reinterpret_cast<const float*>(ptr);
-			float cx = recast[0]*window.width+window.x;
-			float cy = recast[1]*window.height+window.y;
-			float w = recast[2]*window.width;
-			float h = recast[3]*window.height;
-			boxes.emplace_back(cx-w/2, cy-h/2, w, h);
-			scores.emplace_back(recast[4]);
-			auto& classesloc = classes.emplace_back();
-			classesloc.resize(numclasses);
-			copy(&recast[5], &recast[numelem], classesloc.data());
+	vector<int> classes, images;
+	//one detection per row, layout is x, y, width, height, [objectness], classes...
+	//Darknet class scores already include the objectness (Region layer), YOLOv5 ones have to be multiplied by it
+	auto decode = [&](const float* row, int stride, int image, bool HasObjectness, bool ApplyObjectness)
+	{
+		const float* classscores = row + (HasObjectness ? 5 : 4)*stride;
+		int bestclass = 0;
+		for (int i = 1; i < numclasses; i++)
+		{
+			if (classscores[i*stride] > classscores[bestclass*stride])
+			{
+				bestclass = i;
+			}
+		}
+		float confidence = classscores[bestclass*stride] * (ApplyObjectness ? row[4*stride] : 1.f);
+		if (confidence < ConfidenceThreshold)
+		{
+			return;
+		}
+		double sx = NormalizedOutput ? inpSize.width : 1, sy = NormalizedOutput ? inpSize.height : 1;
+		double w = row[2*stride]*sx, h = row[3*stride]*sy;
+		double x = row[0]*sx - w/2, y = row[1*stride]*sy - h/2;
+		boxes.emplace_back(x, y, w, h);
+		scores.push_back(confidence);
+		classes.push_back(bestclass);
+		images.push_back(image);
+	};
+	for (const Mat &blob : outputBlobs)
+	{
+		assert(blob.depth() == CV_32F);
+		int dims = blob.size.dims();
+		if (dims == 2)
+		{
+			//Darknet : all images are stacked, [batch*N, 5+classes]
+			assert(blob.size[1] == numclasses + 5);
+			int rowsperimage = blob.size[0] / batchsize;
+			for (int r = 0; r < blob.size[0]; r++)
+			{
+				decode(blob.ptr<float>(r), 1, r / rowsperimage, true, false);
+			}
+		}
+		else if (dims == 3 && blob.size[2] == numclasses + 5)
+		{
+			//YOLOv5 style : [batch, N, 5+classes]
+			for (int b = 0; b < blob.size[0]; b++)
+			{
+				const float* data = blob.ptr<float>(b);
+				for (int r = 0; r < blob.size[1]; r++)
+				{
+					decode(data + r*blob.size[2], 1, b, true, true);
+				}
+			}
+		}
+		else if (dims == 3 && blob.size[1] == numclasses + 4)
+		{
+			//YOLOv8 style : [batch, 4+classes, N], no objectness, read column-wise
+			for (int b = 0; b < blob.size[0]; b++)
+			{
+				const float* data = blob.ptr<float>(b);
+				for (int r = 0; r < blob.size[2]; r++)
+				{
+					decode(data + r, blob.size[2], b, false, false);
+				}
+			}
+		}
+		else
+		{
+			cerr << "Unsupported yolo output shape " << blob.size << endl;
 		}
 	}
+	//images are used as NMS classes so that detections of different images never suppress each other
 	vector<int> keptIndices;
-	dnn::NMSBoxes(boxes, scores, 0.4, 0.5, keptIndices);
-	vector<Detection> OutDetections;
-	OutDetections.reserve(keptIndices.size());
+	dnn::NMSBoxesBatched(boxes, scores, images, ConfidenceThreshold, NMSThreshold, keptIndices);
+	vector<vector<Detection>> OutDetections(batchsize);
 	for (int kept : keptIndices)
 	{
-		OutDetections.emplace_back(boxes[kept], scores[kept], classes[kept]);
+		const Letterbox &box = Letterboxes[images[kept]];
+		Rect2d &input = boxes[kept];
+		Rect2f lens((input.x - box.Offset.x) / box.Scale, (input.y - box.Offset.y) / box.Scale, 
+			input.width / box.Scale, input.height / box.Scale);
+		OutDetections[images[kept]].push_back({lens, scores[kept], classes[kept]});
 	}
 	return OutDetections;
 }
@@ -132,95 +208,120 @@ int YoloDetect::GetNumClasses() const
 	return ClassNames.size();
 }
 
-int YoloDetect::Detect(CameraImageData InData, CameraFeatureData *OutData)
+int YoloDetect::DetectBatch(const vector<CameraImageData> &InData, const vector<CameraFeatureData*> &OutData)
 {
-	#if 1
-	(void)InData;
-	(void)OutData;
-	assert(0);
-	return 0;
-	//TODO : Fix stereo
-	#else
-	Preprocess(InData.Image, modelSize, 1.0/255.0, 0, true);
-	auto start = chrono::steady_clock::now();
+	assert(InData.size() == OutData.size());
+	if (!NetworkLoaded)
+	{
+		return 0;
+	}
+	//one batch entry per lens
+	vector<pair<size_t, size_t>> entries;
+	for (size_t camidx = 0; camidx < InData.size(); camidx++)
+	{
+		if (!InData[camidx].Valid || OutData[camidx] == nullptr)
+		{
+			continue;
+		}
+		for (size_t lensidx = 0; lensidx < InData[camidx].lenses.size(); lensidx++)
+		{
+			entries.emplace_back(camidx, lensidx);
+		}
+		for (auto &lens : OutData[camidx]->Lenses)
+		{
+			lens.YoloDetections.clear();
+		}
+	}
+	if (entries.size() == 0)
+	{
+		return 0;
+	}
+	LetterboxBuffers.resize(entries.size());
+	vector<Letterbox> Letterboxes(entries.size());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		auto &image = InData[entries[i].first];
+		Letterboxes[i] = Preprocess(image.Image(image.lenses[entries[i].second].ROI), modelSize, LetterboxBuffers[i]);
+	}
+	vector<Mat> Inputs(LetterboxBuffers.begin(), LetterboxBuffers.begin() + entries.size());
+	Mat blob;
+	dnn::blobFromImages(Inputs, blob, 1.0/255.0, modelSize, Scalar(), true, false);
+	network.setInput(blob);
+
 	vector<Mat> outputBlobs;
 	auto OutputNames = network.getUnconnectedOutLayersNames();
-	network.forward(outputBlobs, OutputNames);
-	auto stop = chrono::steady_clock::now();
-	auto detections = Postprocess(outputBlobs, OutputNames, Rect(0,0,InData.Image.cols, InData.Image.rows));
-	int numdetections = detections.size();
-	OutData->YoloDetections.clear();
-	OutData->YoloDetections.reserve(numdetections);
-	for (auto &det : detections)
-	{
-		int maxidx = 0;
-		for (size_t i = 1; i < det.Classes.size(); i++)
-		{
-			if (det.Classes[i] > det.Classes[maxidx])
-			{
-				maxidx = i;
-			}
+	try
+	{
+		network.forward(outputBlobs, OutputNames);
+	}
+	catch(const std::exception& e)
+	{
+		cerr << "Yolo inference failed : " << e.what() << endl;
+		return 0;
+	}
+	auto detections = Postprocess(outputBlobs, Letterboxes, modelSize, ClassNames.size(), NormalizedOutput);
+	int numdetections = 0;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		auto &lensdetections = OutData[entries[i].first]->Lenses[entries[i].second].YoloDetections;
+		lensdetections.reserve(detections[i].size());
+		for (auto &det : detections[i])
+		{
+			YoloDetection final_detection;
+			final_detection.Class = det.Class;
+			final_detection.Confidence = det.Confidence;
+			final_detection.Corners = det.BoundingBox;
+			lensdetections.push_back(final_detection);
 		}
-		YoloDetection final_detection;
-		//cout << "Found " << maxidx << " at " << det.BoundingBox << " (Confidence " << det.Confidence << ")" << endl;
-		final_detection.Class = maxidx;
-		final_detection.Confidence = det.Confidence;
-		final_detection.Corners = det.BoundingBox;
-		OutData->YoloDetections.push_back(final_detection);
+		numdetections += detections[i].size();
 	}
-	(void) start; (void) stop;
-	//cout << "Inference took " << chrono::duration<double>(stop-start).count() << "s and found " << numdetections << " objects" << endl;
 	return numdetections;
-	#endif
+}
+
+int YoloDetect::Detect(CameraImageData InData, CameraFeatureData *OutData)
+{
+	return DetectBatch({InData}, {OutData});
 }
 
 static_assert(sizeof(Matx31d) == sizeof(Vec3d));
 vector<ObjectData> YoloDetect::Project(const CameraImageData &ImageData, const CameraFeatureData& FeatureData)
 {
-	#if 1
-	(void)ImageData;
-	(void)FeatureData;
-	assert(0);
-	return {};
-	#else
 	vector<ObjectData> objects;
-	size_t NumDetections = FeatureData.YoloDetections.size();
-	if (NumDetections == 0)
-	{
-		return objects;
-	}
-	
-	objects.reserve(NumDetections);
-
-	vector<Point2f> DistortedImagePoints, UndistortedImagePoints;
-	DistortedImagePoints.resize(NumDetections);
-	for (size_t i = 0; i < NumDetections; i++)
-	{
-		auto &Detection = FeatureData.YoloDetections[i];
-		DistortedImagePoints[i] = (Detection.Corners.tl() + Detection.Corners.br())/2.0;
-	}
-	//TODO : Support stereo
-	undistortPoints(DistortedImagePoints, UndistortedImagePoints, ImageData.lenses[0].CameraMatrix, ImageData.lenses[0].distanceCoeffs);
-	for (size_t i = 0; i < NumDetections; i++)
-	{
-		auto &Detection = FeatureData.YoloDetections[i];
-		//auto ROI = ImageData.Image(Detection.Corners);
-		auto center = UndistortedImagePoints[i];
-		Matx31d vector = {center.x, center.y, 1};
-		Matx31d WorldVector = FeatureData.WorldToCamera.rotation() * vector;
-		double InterceptHeight = Detection.Class >= 2 ? 0.03 : 0.02;
-		Vec3d WorldPosition = LinePlaneIntersection(FeatureData.WorldToCamera.translation(), 
-			*reinterpret_cast<Vec3d*>(&WorldVector), Vec3d(0,0,InterceptHeight), Vec3d(0,0,1));
-		WorldPosition[2] = 0;
-		ObjectType type = (ObjectType)((int)ObjectType::Fragile + Detection.Class);
-		const auto &name = GetClassName(Detection.Class);
-		ObjectData object(type, name, 
-			Affine3d(Vec3d::all(0), WorldPosition));
-		object.metadata["confidence"] = int(Detection.Confidence*100);
-		objects.emplace_back(object);
-		//imshow("Yolo ROI", ROI);
-		//waitKey(10);
+	for (const LensFeatureData &lens : FeatureData.Lenses)
+	{
+		size_t NumDetections = lens.YoloDetections.size();
+		if (NumDetections == 0)
+		{
+			continue;
+		}
+		objects.reserve(objects.size() + NumDetections);
+
+		vector<Point2f> DistortedImagePoints, UndistortedImagePoints;
+		DistortedImagePoints.resize(NumDetections);
+		for (size_t i = 0; i < NumDetections; i++)
+		{
+			auto &Detection = lens.YoloDetections[i];
+			DistortedImagePoints[i] = (Detection.Corners.tl() + Detection.Corners.br())/2.0;
+		}
+		undistortPoints(DistortedImagePoints, UndistortedImagePoints, lens.CameraMatrix, lens.DistanceCoefficients);
+		Affine3d WorldToLens = FeatureData.WorldToCamera * lens.CameraToLens;
+		for (size_t i = 0; i < NumDetections; i++)
+		{
+			auto &Detection = lens.YoloDetections[i];
+			auto center = UndistortedImagePoints[i];
+			Matx31d vector = {center.x, center.y, 1};
+			Matx31d WorldVector = WorldToLens.rotation() * vector;
+			double InterceptHeight = Detection.Class >= 2 ? 0.03 : 0.02;
+			Vec3d WorldPosition = LinePlaneIntersection(WorldToLens.translation(), 
+				*reinterpret_cast<Vec3d*>(&WorldVector), Vec3d(0,0,InterceptHeight), Vec3d(0,0,1));
+			WorldPosition[2] = 0;
+			ObjectType type = (ObjectType)((int)ObjectType::Fragile2024 + Detection.Class);
+			const auto &name = GetClassName(Detection.Class);
+			ObjectData object(type, name, 
+				Affine3d(Vec3d::all(0), WorldPosition), ImageData.GrabTime);
+			object.metadata["confidence"] = int(Detection.Confidence*100);
+			objects.emplace_back(object);
+		}
 	}
 	return objects;
-	#endif
 }
@@ -80,7 +80,7 @@ void CDFRCommon::MakeTrackedObjects(bool Internal, map<CDFRTeam, ObjectTracker&>
 
 bool CDFRCommon::ImageToFeatureData(const CDFRCommon::Settings &Settings,  
 		Camera* cam, const CameraImageData& ImData, CameraFeatureData& FeatData, 
-		ObjectTracker& Tracker, std::chrono::steady_clock::time_point GrabTick, YoloDetect *YoloDetector)
+		const TrackerSnapshot& Tracker, std::chrono::steady_clock::time_point GrabTick, LatencyStats* Latency)
 {
 	if (ImData.Image.size() != cam->GetCameraSettings()->Resolution)
 	{
@@ -88,73 +88,51 @@ bool CDFRCommon::ImageToFeatureData(const CDFRCommon::Settings &Settings,
 		return false;
 	}
 	
-	constexpr bool use_threads = false;
 	FeatData.Clear();
 	FeatData.CopyEssentials(ImData);
-	bool doYolo = Settings.YoloDetection && YoloDetector;
 	bool doAruco = Settings.ArucoDetection;
-	unique_ptr<thread> yoloThread;
-	unique_ptr<thread> arucoThread;
-	Size basesize = ImData.lenses[0].ROI.size();
-	Size NumArucoSegments = basesize/800 + Size(1,1);
-	const auto processor_count = std::thread::hardware_concurrency();
-	if (NumArucoSegments.area() > processor_count && processor_count > 0)
+	Size NumArucoSegments = ArucoGridTuner::GetDefaultGrid(ImData.lenses[0].ROI.size());
+	int ArucoOverlap = ArucoGridTuner::DefaultOverlap;
+	bool TuneGrid = doAruco && Settings.SegmentedDetection && Settings.TuneSegments && cam;
+	if (TuneGrid)
 	{
-		double aspect_ratio = basesize.aspectRatio();
-		int area = ImData.lenses[0].ROI.area();
-		NumArucoSegments.width = ceil(sqrt(processor_count) * aspect_ratio);
-		NumArucoSegments.height = ceil(sqrt(processor_count) / aspect_ratio);
+		//location of the previous frame, close enough for the overlap
+		cam->ArucoGrid.Prepare(ImData, cam->GetLocation(), Tracker.LargestArucoSize);
+		NumArucoSegments = cam->ArucoGrid.GetGrid();
+		ArucoOverlap = cam->ArucoGrid.GetOverlap();
 	}
-	if (doYolo)
+	StageTimer Timer(Latency);
+	//YOLO is not done here : it runs on its own lane so that the aruco poses never wait for it
+	if (doAruco)
 	{
-		if (use_threads)
+		auto SweepStart = chrono::steady_clock::now();
+		bool FullSweep = true;
+		if (Settings.SegmentedDetection && Settings.TrackedDetection && cam)
 		{
-			yoloThread = make_unique<thread>(&YoloDetect::Detect, YoloDetector, 
-				ImData, &FeatData);
+			FullSweep = cam->ArucoTracking.SweepDue(ImData.lenses.size(), Settings.FullSweepInterval);
+			DetectArucoTracked(ImData, &FeatData, cam->ArucoTracking, ArucoOverlap, NumArucoSegments, Settings.FullSweepInterval);
 		}
-		else
+		else if (Settings.SegmentedDetection)
 		{
-			YoloDetector->Detect(ImData, &FeatData);
+			DetectArucoSegmented(ImData, &FeatData, ArucoOverlap, NumArucoSegments);
 		}
-	}
-	if (doAruco)
-	{
-		if (use_threads)
+		else
 		{
-			if (Settings.SegmentedDetection)
-			{
-				arucoThread = make_unique<thread>(DetectArucoSegmented, ImData, &FeatData, 200, NumArucoSegments);
-			}
-			else
-			{
-				arucoThread = make_unique<thread>(DetectAruco, ImData, &FeatData);
-			}
+			DetectAruco(ImData, &FeatData);
 		}
-		else
+		//only the full sweeps use the grid, the tracked frames search around the last tags
+		if (TuneGrid && FullSweep)
 		{
-			if (Settings.SegmentedDetection)
-			{
-				
-				
-				DetectArucoSegmented(ImData, &FeatData, 200, NumArucoSegments);
-			}
-			else
-			{
-				DetectAruco(ImData, &FeatData);
-			}
+			cam->ArucoGrid.AddSweep(chrono::duration<double>(chrono::steady_clock::now() - SweepStart).count());
 		}
+		Timer.Lap("aruco");
 	}
 	
 	if (cam)
 	{
 		if (Settings.SolveCameraLocation && !cam->PositionLocked)
 		{
-			if (arucoThread)
-			{
-				arucoThread->join();
-				arucoThread.reset();
-			}
-	
+			Timer.Restart();
 			PolyCameraArucoMerge(FeatData);
 			
 			bool HasPosition = Tracker.SolveCameraLocation(FeatData);
@@ -163,6 +141,7 @@ bool CDFRCommon::ImageToFeatureData(const CDFRCommon::Settings &Settings,
 				cam->SetLocation(FeatData.WorldToCamera, GrabTick);
 				//cout << "Camera has location" << endl;
 			}
+			Timer.Lap("camera solve");
 		}
 		else
 		{
@@ -174,12 +153,7 @@ bool CDFRCommon::ImageToFeatureData(const CDFRCommon::Settings &Settings,
 		
 		if (Settings.POIDetection)
 		{
-			if (arucoThread)
-			{
-				arucoThread->join();
-				arucoThread.reset();
-			}
-			const auto &POIs = Tracker.GetPointsOfInterest();
+			const auto &POIs = Tracker.PointsOfInterest;
 			DetectArucoPOI(ImData, &FeatData, POIs);
 		}
 	}
@@ -187,16 +161,6 @@ bool CDFRCommon::ImageToFeatureData(const CDFRCommon::Settings &Settings,
 	{
 		FeatData.WorldToCamera = Affine3d::Identity();
 	}
-	if (yoloThread)
-	{
-		yoloThread->join();
-		yoloThread.reset();
-	}
-	if (arucoThread)
-	{
-		arucoThread->join();
-		arucoThread.reset();
-	}
 
 	if (!Settings.SolveCameraLocation || cam->PositionLocked)
 	{
@@ -13,6 +13,9 @@
 #include <Visualisation/external/ExternalBoardGL.hpp>
 #include <Visualisation/external/ExternalImgui.hpp>
 
+#include <EntryPoints/CameraWorker.hpp>
+#include <EntryPoints/YoloLane.hpp>
+
 #include <Misc/ManualProfiler.hpp>
 #include <Misc/math2d.hpp>
 #include <Misc/path.hpp>
@@ -20,6 +23,8 @@
 #include <Transport/TCPTransport.hpp>
 #include <Transport/UDPTransport.hpp>
 #include <Cameras/CameraManagerV4L2.hpp>
+#include <Cameras/V4L2Camera.hpp>
+#include <Cameras/RawRecordingCamera.hpp>
 #include <Cameras/CameraManagerSimulation.hpp>
 #include <Cameras/VideoCaptureCamera.hpp>
 
@@ -31,11 +36,14 @@
 
 #include <thread>
 #include <memory>
+#include <fstream>
+#include <nlohmann/json.hpp>
 
 #include <thirdparty/HsvConverter.h>
 
 
-CDFRExternal::CDFRExternal()
+CDFRExternal::CDFRExternal(filesystem::path InReplayPath, optional<ExternalBenchmark> InBench)
+	:ReplayPath(InReplayPath), Bench(InBench)
 {
 
 	assert(ObjData.size() == FeatureData.size());
@@ -112,7 +120,10 @@ CDFRTeam CDFRExternal::GetTeamFromCameraPosition(vector<Camera*> Cameras)
 void CDFRExternal::SetIdle(bool value)
 {
 	Idle = value;
-	CameraMan->SetIdle(value);
+	if (CameraMan)
+	{
+		CameraMan->SetIdle(value);
+	}
 }
 
 void CDFRExternal::SetCameraLock(bool value)
@@ -122,20 +133,105 @@ void CDFRExternal::SetCameraLock(bool value)
 
 CDFRTeam CDFRExternal::GetTeam()
 {
+	if (LockedTeam != CDFRTeam::Unknown || !CameraMan)
+	{
+		return LockedTeam;
+	}
 	auto Cameras = CameraMan->GetCameras();
-	CDFRTeam Team = LockedTeam == CDFRTeam::Unknown ? GetTeamFromCameraPosition(Cameras) : LockedTeam;
-	return Team;
+	return GetTeamFromCameraPosition(Cameras);
 }
 
-using ExternalProfType = ManualProfiler<false>;
+ObjectTracker& CDFRExternal::GetTracker(CDFRTeam Team)
+{
+	switch (Team)
+	{
+	case CDFRTeam::Blue:
+		return BlueTracker;
+	case CDFRTeam::Yellow:
+		return YellowTracker;
+	default:
+		return UnknownTracker;
+	}
+}
+
+void CDFRExternal::Publish(shared_ptr<ExternalSnapshot> Snapshot)
+{
+	//readers holding the previous snapshot keep it alive until they are done
+	Snapshot->Sequence = SnapshotSequence.load() + 1;
+	shared_ptr<const ExternalSnapshot> Published = move(Snapshot);
+	atomic_store(&LatestSnapshot, Published);
+	{
+		unique_lock lock(SnapshotMutex);
+		SnapshotSequence.store(Published->Sequence);
+	}
+	SnapshotPublished.notify_all();
+}
+
+void CDFRExternal::ReplayEntryPoint(ExternalProfType &prof)
+{
+	FeatureLog::Reader Log;
+	if (!Log.Open(ReplayPath))
+	{
+		killed = true;
+		return;
+	}
+	cout << "Replaying feature log " << ReplayPath << endl;
+	FeatureLog::Tick Tick;
+	size_t NumTicks = 0;
+	auto ReplayStart = chrono::steady_clock::now();
+	while (!killed && Log.Next(Tick))
+	{
+		prof.EnterSection("3D Solve");
+		//the post processing asks the runner for the team
+		LockedTeam = Tick.Team;
+		ObjectTracker &Tracker = GetTracker(Tick.Team);
+		auto Snapshot = make_shared<ExternalSnapshot>();
+		Snapshot->FeatureData = move(Tick.Features);
+		Tracker.SolveLocationsPerObject(Snapshot->FeatureData, Tick.Time);
+		Snapshot->ObjData = Tracker.GetObjectDataVector(Tick.Time);
+		prof.EnterSection("Post Processing");
+		for (auto &i : PostProcesses)
+		{
+			i->Process(Snapshot->ImageData, Snapshot->FeatureData, Snapshot->ObjData);
+		}
+		prof.EnterSection("");
+		Publish(move(Snapshot));
+		NumTicks++;
+	}
+	double duration = chrono::duration<double>(chrono::steady_clock::now() - ReplayStart).count();
+	cout << "Replayed " << NumTicks << " ticks in " << duration << "s (" << NumTicks / max(duration, 1e-9) << " ticks/s)" << endl;
+	prof.PrintProfile();
+	killed = true;
+}
 
 void CDFRExternal::ThreadEntryPoint()
 {
 	SetThreadName("CDFRExternal runner");
 	ExternalProfType prof("External Global Profile");
 	ExternalProfType ParallelProfiler("Parallel Cameras Detail");
+
+	//PostProcesses.emplace_back(make_unique<PostProcessYoloDeflicker>(this));
+	PostProcesses.emplace_back(make_unique<PostProcessZone>(this));
+	//PostProcesses.emplace_back(make_unique<PostProcessJardinieres>(this));
+	//PostProcesses.emplace_back(make_unique<PostProcessSolarPanel>(this));
+
+	if (!ReplayPath.empty())
+	{
+		ReplayEntryPoint(prof);
+		return;
+	}
 	
-	if (GetScenario().size())
+	if (Bench.has_value())
+	{
+		//regressions must give the same ticks on every run
+		optional<bool> RealTime;
+		if (!Bench->Golden.empty())
+		{
+			RealTime = false;
+		}
+		CameraMan = make_unique<CameraManagerSimulation>(GetScenarioPath(Bench->Scenario), RealTime);
+	}
+	else if (GetScenario().size())
 	{
 		auto basepath = GetCyclopsPath() / "sim";
 		CameraMan = make_unique<CameraManagerSimulation>(basepath/GetScenario());
@@ -147,21 +243,17 @@ void CDFRExternal::ThreadEntryPoint()
 	}
 
 	YoloDetector = make_unique<YoloDetect>("cdfr", 4);
-
-	//PostProcesses.emplace_back(make_unique<PostProcessYoloDeflicker>(this));
-	PostProcesses.emplace_back(make_unique<PostProcessZone>(this));
-	//PostProcesses.emplace_back(make_unique<PostProcessJardinieres>(this));
-	//PostProcesses.emplace_back(make_unique<PostProcessSolarPanel>(this));
+	YoloInference = make_unique<YoloLane>(YoloDetector.get());
 
 	//display/debug section
 	FrameCounter fps;
 	
 	//OpenGLBoard.InspectObject(blue1);
-	if (CDFRCommon::ExternalSettings.v3d || DoScreenCapture())
+	if ((CDFRCommon::ExternalSettings.v3d || DoScreenCapture()) && !Bench.has_value())
 	{
 		Open3DVisualizer();
 	}
-	if (CDFRCommon::ExternalSettings.direct || DoScreenCapture())
+	if ((CDFRCommon::ExternalSettings.direct || DoScreenCapture()) && !Bench.has_value())
 	{
 		OpenDirectVisualizer();
 	}
@@ -172,7 +264,20 @@ void CDFRExternal::ThreadEntryPoint()
 	//track and untrack cameras dynamically
 	CameraMan->StartCamera = [](VideoCaptureCameraSettings settings) -> shared_ptr<Camera>
 	{
-		auto cam = make_shared<VideoCaptureCamera>(make_shared<VideoCaptureCameraSettings>(settings));
+		shared_ptr<Camera> cam;
+		if (settings.StartType == CameraStartType::V4L2)
+		{
+			cam = make_shared<V4L2Camera>(make_shared<VideoCaptureCameraSettings>(settings));
+		}
+		else if (settings.StartType == CameraStartType::PLAYBACK 
+			&& filesystem::path(settings.StartPath).extension() == RawRecording::Extension)
+		{
+			cam = make_shared<RawRecordingCamera>(make_shared<VideoCaptureCameraSettings>(settings));
+		}
+		else
+		{
+			cam = make_shared<VideoCaptureCamera>(make_shared<VideoCaptureCameraSettings>(settings));
+		}
 		if(!cam->StartFeed())
 		{
 			cerr << "Failed to start feed @" << settings.DeviceInfo.device_description << endl;
@@ -190,10 +295,12 @@ void CDFRExternal::ThreadEntryPoint()
 		}
 		BlueTracker.RegisterTrackedObject(cam);
 		YellowTracker.RegisterTrackedObject(cam);
+		Workers[cam.get()] = make_unique<CameraWorker>(cam);
 		cout << "Registering new camera @" << cam << ", name " << cam->GetName() << endl;
 	};
 	CameraMan->StopCamera = [this](shared_ptr<Camera> cam) -> bool
 	{
+		Workers.erase(cam.get());
 		BlueTracker.UnregisterTrackedObject(cam);
 		YellowTracker.UnregisterTrackedObject(cam);
 		cout << "Unregistering camera @" << cam << endl;
@@ -203,6 +310,24 @@ void CDFRExternal::ThreadEntryPoint()
 
 	CameraMan->Start();
 
+
+	//the first ticks with frames fill the caches and find the cameras, they are not measured
+	const size_t BenchWarmupTicks = 10;
+	size_t BenchTicks = 0, BenchFrames = 0;
+	LatencyStats BenchLatency;
+	auto BenchStart = chrono::steady_clock::now(), BenchLastTick = BenchStart;
+	Regression::Trajectory GoldenTrajectory, BenchTrajectory;
+	bool BenchRegression = Bench.has_value() && !Bench->Golden.empty();
+	if (BenchRegression && !Bench->RecordGolden)
+	{
+		if (!Regression::Load(Bench->Golden, GoldenTrajectory))
+		{
+			BenchmarkFailed = true;
+			killed = true;
+			return;
+		}
+		Bench->Ticks = max<int>(1, (int)GoldenTrajectory.Ticks.size() - (int)BenchWarmupTicks);
+	}
 	
 	while (!killed)
 	{
@@ -232,12 +357,68 @@ void CDFRExternal::ThreadEntryPoint()
 			cout << "Exiting idle..." << endl;
 			LastIdle = false;
 		}
-		vector<Camera*> Cameras;
 		double deltaTime = fps.GetDeltaTime();
+
+		//Collect the frames requested last tick before the camera manager or the trackers get modified
+		prof.EnterSection("Camera Gather Frames");
+		int NumCams = InFlightCameras.size();
+		auto Snapshot = make_shared<ExternalSnapshot>();
+		vector<CameraImageData> &ImageDataLocal = Snapshot->ImageData;
+		vector<CameraFeatureData> &FeatureDataLocal = Snapshot->FeatureData;
+		ImageDataLocal.resize(NumCams);
+		FeatureDataLocal.resize(NumCams);
+		bool BenchMeasure = Bench.has_value() && BenchTicks >= BenchWarmupTicks;
+		bool HasFrames = false;
+		for (int i = 0; i < NumCams; i++)
+		{
+			auto &worker = Workers.at(InFlightCameras[i]);
+			auto result = worker->Collect(chrono::milliseconds(2000));
+			if (!result.has_value())
+			{
+				cerr << "Camera " << InFlightCameras[i]->GetName() << " did not deliver a frame in time" << endl;
+				ImageDataLocal[i] = CameraImageData();
+				FeatureDataLocal[i].Clear();
+				continue;
+			}
+			ImageDataLocal[i] = move(result->ImageData);
+			FeatureDataLocal[i] = move(result->FeatureData);
+			ParallelProfiler += result->Profiler;
+			if (!ImageDataLocal[i].Image.empty())
+			{
+				HasFrames = true;
+				if (BenchMeasure)
+				{
+					BenchLatency += result->Latency;
+					BenchFrames++;
+				}
+			}
+		}
+		BenchMeasure &= HasFrames;
+		if (BenchMeasure)
+		{
+			BenchLatency.Add("tick", chrono::steady_clock::now() - BenchLastTick);
+		}
+		BenchLastTick = chrono::steady_clock::now();
+		if (Bench.has_value() && HasFrames)
+		{
+			BenchTicks++;
+			if (BenchTicks == BenchWarmupTicks)
+			{
+				BenchStart = chrono::steady_clock::now();
+			}
+		}
+		if (CDFRCommon::ExternalSettings.YoloDetection)
+		{
+			YoloInference->Submit(ImageDataLocal, FeatureDataLocal);
+		}
+		ObjectTracker* SolvedTracker = InFlightTracker;
+		auto SolvedGrabTick = InFlightGrabTick;
+
+		vector<Camera*> Cameras;
 		prof.EnterSection("CameraManager Tick");
 		Cameras = CameraMan->Tick();
 		bool HasNoData = Cameras.size() == 0;
-		bool IsUnseen = HasNoClients && !DirectImage && !OpenGLBoard;
+		bool IsUnseen = HasNoClients && !DirectImage && !OpenGLBoard && !CameraMan->IsReplay();
 		if (HasNoData || IsUnseen)
 		{
 			prof.EnterSection("Sleep");
@@ -304,108 +485,98 @@ void CDFRExternal::ThreadEntryPoint()
 			LastRecordTime = ObjectData::Clock::now();
 		}
 		
-		
-		
-		
-		prof.EnterSection("Camera Gather Frames");
-		auto GrabTick = chrono::steady_clock::now();
-		
-		for (size_t i = 0; i < Cameras.size(); i++)
+		//Start the next frame on every camera : grab, read, undistort and detection run on the workers while this thread solves the frame collected above
+		prof.EnterSection("Camera Dispatch");
+		auto GrabTick = CameraMan->GetTickTime();
+		InFlightCameras.clear();
+		auto TrackerView = TrackerToUse->GetSnapshot(CDFRCommon::ExternalSettings.POIDetection);
+		for (Camera* cam : Cameras)
 		{
-			Cameras[i]->Grab();
+			CameraWorker::Job job{TrackerView, GrabTick, RecordThisTick, RecordRootPath, RecordImageIndex, Bench.has_value()};
+			auto &worker = Workers.at(cam);
+			if (worker->Request(job) || worker->IsInFlight())
+			{
+				InFlightCameras.push_back(cam);
+			}
 		}
+		InFlightTracker = TrackerToUse;
+		InFlightGrabTick = GrabTick;
 
-		int NumCams = Cameras.size();
-		vector<CameraImageData> &ImageDataLocal = ImageData[BufferIndex];
-		vector<CameraFeatureData> &FeatureDataLocal = FeatureData[BufferIndex];
-		vector<ExternalProfType> ParallelProfilers;
-		ImageDataLocal.resize(NumCams);
-		FeatureDataLocal.resize(NumCams);
-		ParallelProfilers.resize(NumCams);
-		prof.EnterSection("Parallel Cameras");
-
-		//grab frames
-		//read frames
-		//undistort
-		//detect aruco and yolo
-
-		/*parallel_for_(Range(0, Cameras.size()), 
-		[&Cameras, &FeatureDataLocal, &CamerasWithPosition, TrackerToUse, GrabTick, &ParallelProfilers]
-		(Range InRange)*/
+		prof.EnterSection("3D Solve");
+		StageTimer BenchTimer(BenchMeasure ? &BenchLatency : nullptr);
+		SolvedTracker->SolveLocationsPerObject(FeatureDataLocal, SolvedGrabTick);
+		vector<ObjectData> &ObjDataLocal = Snapshot->ObjData;
+		ObjDataLocal = SolvedTracker->GetObjectDataVector(SolvedGrabTick);
+		BenchTimer.Lap("object solve");
+		//before yolo and the post processing, which don't follow the replay clock
+		if (BenchRegression && HasFrames)
+		{
+			BenchTrajectory.Ticks.push_back(Regression::ToPoses(ObjDataLocal));
+		}
+		if (CDFRCommon::ExternalSettings.YoloDetection)
 		{
-			Range InRange(0, Cameras.size());
-			for (int i = InRange.start; i < InRange.end; i++)
+			//attach the newest yolo results, they may be a frame or two older than the aruco data
+			auto YoloResult = YoloInference->GetLatest();
+			if (SolvedGrabTick - YoloResult->GrabTime < chrono::seconds(1))
 			{
-				auto &thisprof = ParallelProfilers[i];
-				Camera* cam = Cameras[i];
-				auto cam_settings = cam->GetCameraSettings();
-				CameraFeatureData &FeatData = FeatureDataLocal[i];
-				thisprof.EnterSection("CameraRead");
-				if(!cam->Read())
-				{
-					FeatData.Clear();
-					continue;
-				}
-				if (cam_settings->WantUndistortion || (cam_settings->IsStereo() && CDFRCommon::ExternalSettings.DepthMapping))
-				{
-					thisprof.EnterSection("CameraUndistort");
-					cam->Undistort();
-				}
-				thisprof.EnterSection("CameraGetFrame");
-				CameraImageData &ImData = ImageDataLocal[i];
-				ImData = cam->GetFrame(!cam->GetCameraSettings()->WantUndistortion);
-				//cout << "Frame " << BufferIndex << " at " << ImData.Image.u << endl;
-				CDFRCommon::ImageToFeatureData(CDFRCommon::ExternalSettings, cam, ImData, FeatData, *TrackerToUse, GrabTick, YoloDetector.get());
-
-				if (cam_settings->IsStereo() && CDFRCommon::ExternalSettings.DepthMapping)
-				{
-					CameraImageData StereoData = cam->GetFrame(false);
-					DetectStereo(StereoData, FeatData);
-				}
-				
-				if (RecordThisTick)
+				for (auto &Features : FeatureDataLocal)
 				{
-					cout << "\aRecording image " << TimeToStr() << endl;
-					cam->Record(RecordRootPath, RecordImageIndex);
+					auto found = YoloResult->Detections.find(Features.CameraName);
+					if (found == YoloResult->Detections.end())
+					{
+						continue;
+					}
+					for (size_t lensidx = 0; lensidx < Features.Lenses.size() && lensidx < found->second.size(); lensidx++)
+					{
+						Features.Lenses[lensidx].YoloDetections = found->second[lensidx];
+					}
 				}
-				
-				thisprof.EnterSection("");
+				ObjDataLocal.insert(ObjDataLocal.end(), YoloResult->Objects.begin(), YoloResult->Objects.end());
 			}
 		}
-		//);
 
-		for (auto &pprof : ParallelProfilers)
+		BenchTimer.Restart();
+		for (auto &i : PostProcesses)
 		{
-			ParallelProfiler += pprof;
+			i->Process(ImageDataLocal, FeatureDataLocal, ObjDataLocal);
 		}
+		BenchTimer.Lap("post process");
+		
 
-		prof.EnterSection("3D Solve");
-		TrackerToUse->SolveLocationsPerObject(FeatureDataLocal, GrabTick);
-		vector<ObjectData> &ObjDataLocal = ObjData[BufferIndex]; 
-		ObjDataLocal = TrackerToUse->GetObjectDataVector(GrabTick);
-		for (size_t camidx = 0; camidx < Cameras.size() * CDFRCommon::ExternalSettings.YoloDetection; camidx++)
+
+		if (CDFRCommon::ExternalSettings.LogFeatures && NumCams > 0)
 		{
-			if (!ImageDataLocal[camidx].Valid)
+			if (!FeatureLogger)
 			{
-				continue;
+				FeatureLogger = make_unique<FeatureLog::Writer>();
+				FeatureLogger->Open(RecordRootPath / (string("features") + FeatureLog::Extension));
 			}
-			auto YoloObjects = YoloDetector->Project(ImageDataLocal[camidx], FeatureDataLocal[camidx]);
-			ObjDataLocal.insert(ObjDataLocal.end(), YoloObjects.begin(), YoloObjects.end());
+			CDFRTeam SolvedTeam = SolvedTracker == &BlueTracker ? CDFRTeam::Blue 
+				: (SolvedTracker == &YellowTracker ? CDFRTeam::Yellow : CDFRTeam::Unknown);
+			FeatureLogger->Write(SolvedGrabTick, SolvedTeam, FeatureDataLocal, ObjDataLocal);
 		}
-
-		for (auto &i : PostProcesses)
+		else if (!CDFRCommon::ExternalSettings.LogFeatures)
 		{
-			i->Process(ImageDataLocal, FeatureDataLocal, ObjDataLocal);
+			FeatureLogger.reset();
 		}
-		
-		
 
-
-		BufferIndex = (BufferIndex+1)%ObjData.size();
+		shared_ptr<const ExternalSnapshot> Published = Snapshot;
+		Publish(move(Snapshot));
 		if (RecordThisTick)
 		{
 			RecordImageIndex++;
 		}
+
+		if (Bench.has_value() && BenchTicks >= BenchWarmupTicks + Bench->Ticks)
+		{
+			WriteBenchmarkReport(BenchLatency, BenchTicks - BenchWarmupTicks, BenchFrames, chrono::steady_clock::now() - BenchStart);
+			if (BenchRegression)
+			{
+				BenchmarkFailed = !CheckRegression(BenchLatency, GoldenTrajectory, BenchTrajectory);
+			}
+			killed = true;
+			return;
+		}
 		
 		
 		if (OpenGLBoard.get())
@@ -426,7 +597,7 @@ void CDFRExternal::ThreadEntryPoint()
 			}
 			else
 			{
-				if(!OpenGLBoard->Tick(ObjectData::ToGLObjects(ObjDataLocal)))
+				if(!OpenGLBoard->Tick(ObjectData::ToGLObjects(Published->ObjData)))
 				{
 					killed = true;
 					cout << "3D visualizer closed, shutting down..." << endl;
@@ -469,28 +640,86 @@ void CDFRExternal::ThreadEntryPoint()
 			cout << fps.GetFPSString(deltaTime) << endl;
 			prof.PrintProfile();
 			ParallelProfiler.PrintProfile();
+			for (auto &[cam, worker] : Workers)
+			{
+				if (cam->HasCaptureThread())
+				{
+					cout << cam->GetName() << " : " << cam->GetDroppedFrames() << " frames dropped" << endl;
+				}
+				auto RecordDropped = cam->GetRecordDroppedFrames();
+				if (RecordDropped.has_value())
+				{
+					cout << cam->GetName() << " : " << RecordDropped.value() << " frames dropped by the recorder" << endl;
+				}
+			}
 		}
 	}
 }
 
-int CDFRExternal::GetReadBufferIndex() const
+void CDFRExternal::WriteBenchmarkReport(const LatencyStats &Latency, size_t Ticks, size_t Frames, chrono::duration<double> Duration) const
 {
-	return (BufferIndex+FeatureData.size()-1)%FeatureData.size();
+	double seconds = max(Duration.count(), 1e-9);
+	nlohmann::json report;
+	report["scenario"] = Bench->Scenario.string();
+	report["realtime"] = Bench->Golden.empty() && GetScenarioRealTime();
+	report["ticks"] = Ticks;
+	report["frames"] = Frames;
+	report["duration_s"] = Duration.count();
+	report["ticks_per_s"] = Ticks / seconds;
+	report["frames_per_s"] = Frames / seconds;
+	report["stages"] = Latency.ToJson();
+	if (Bench->Output.empty())
+	{
+		cout << report.dump(1, '\t') << endl;
+		return;
+	}
+	ofstream file(Bench->Output);
+	if (!file.is_open())
+	{
+		cerr << "Could not write the benchmark report to " << Bench->Output << endl;
+		cout << report.dump(1, '\t') << endl;
+		return;
+	}
+	file << report.dump(1, '\t');
+	cout << "Benchmark report written to " << Bench->Output << endl;
 }
 
-vector<CameraImageData> CDFRExternal::GetImage() const
+bool CDFRExternal::CheckRegression(const LatencyStats &Latency, const Regression::Trajectory &Golden, Regression::Trajectory &Actual) const
 {
-	return ImageData[GetReadBufferIndex()];
+	double TickP95 = Latency.GetPercentile("tick", 95) * 1e3;
+	if (Bench->RecordGolden)
+	{
+		//leave room for the noise of the machine, the budget can be edited in the file afterwards
+		Actual.TickBudget = Bench->TickBudget > 0 ? Bench->TickBudget : TickP95 * 2;
+		cout << "Recording " << Actual.Ticks.size() << " ticks to " << Bench->Golden << endl;
+		return Regression::Save(Bench->Golden, Actual);
+	}
+	bool passed = true;
+	size_t failures = Regression::Compare(Golden, Actual);
+	if (failures > 0)
+	{
+		cerr << failures << " objects drifted from the golden trajectory" << endl;
+		passed = false;
+	}
+	double budget = Bench->TickBudget > 0 ? Bench->TickBudget : Golden.TickBudget;
+	if (budget > 0 && TickP95 > budget)
+	{
+		cerr << "Tick time p95 is " << TickP95 << "ms, over the " << budget << "ms budget" << endl;
+		passed = false;
+	}
+	cout << "Regression " << (passed ? "passed" : "failed") << " (tick p95 " << TickP95 << "ms)" << endl;
+	return passed;
 }
 
-std::vector<CameraFeatureData> CDFRExternal::GetFeatureData() const
+shared_ptr<const ExternalSnapshot> CDFRExternal::GetSnapshot() const
 {
-	return FeatureData[GetReadBufferIndex()];
+	return atomic_load(&LatestSnapshot);
 }
 
-std::vector<ObjectData> CDFRExternal::GetObjectData() const
+bool CDFRExternal::WaitForSnapshot(uint64_t Sequence, chrono::microseconds Timeout) const
 {
-	return ObjData[GetReadBufferIndex()];
+	unique_lock lock(SnapshotMutex);
+	return SnapshotPublished.wait_for(lock, Timeout, [this, Sequence](){return SnapshotSequence.load() != Sequence;});
 }
 
 void CDFRExternal::Open3DVisualizer()
@@ -533,6 +762,8 @@ void CDFRExternal::OpenDirectVisualizer()
 CDFRExternal::~CDFRExternal()
 {
 	cout << "External runner shutting down..." << endl;
+	Workers.clear();
+	YoloInference.reset();
 	DirectImage.reset();
 	OpenGLBoard.reset();
 }
\ No newline at end of file
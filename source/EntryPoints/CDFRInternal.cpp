@@ -33,7 +33,7 @@ CDFRInternal::InternalResult CDFRInternal::Process(CameraImageData InData, CDFRT
 
 	auto GrabTick = TrackedObject::Clock::now();
 
-	CDFRCommon::ImageToFeatureData(CDFRCommon::InternalSettings, nullptr, InData, response.FeatureData, tracker, GrabTick);
+	CDFRCommon::ImageToFeatureData(CDFRCommon::InternalSettings, nullptr, InData, response.FeatureData, *tracker.GetSnapshot(CDFRCommon::InternalSettings.POIDetection), GrabTick);
 
 	std::vector FDArray({response.FeatureData});
 
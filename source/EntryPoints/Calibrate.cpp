@@ -556,7 +556,7 @@ bool docalibration(VideoCaptureCameraSettings CamSett)
 			Mat image = imread(pathes[i]);
 			UMat image2, undist;
 			image.copyTo(image2);
-			CamToCalib->Read();
+			CamToCalib->NextFrame();
 			CamToCalib->Undistort();
 			CameraImageData Frame = CamToCalib->GetFrame(false);
 			imshow(CalibWindowName, undist);
@@ -595,7 +595,7 @@ bool docalibration(VideoCaptureCameraSettings CamSett)
 		UMat frame;
 		bool CaptureImageThisFrame = false;
 		prof.EnterSection("Read frame");
-		if (!CamToCalib->Read())
+		if (!CamToCalib->NextFrame())
 		{
 			//cout<< "read fail" <<endl;
 			imguiinst.EndFrame();
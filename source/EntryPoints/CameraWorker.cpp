@@ -0,0 +1,155 @@
+#include "EntryPoints/CameraWorker.hpp"
+#include <EntryPoints/CDFRCommon.hpp>
+
+#include <Cameras/Camera.hpp>
+#include <ArucoPipeline/ObjectTracker.hpp>
+#include <DetectFeatures/StereoDetect.hpp>
+#include <Misc/GlobalConf.hpp>
+#include <Transport/thread-rename.hpp>
+
+using namespace std;
+
+CameraWorker::CameraWorker(shared_ptr<Camera> InCam)
+	:Cam(InCam), Jobs(1), Results(1)
+{
+	//playback has to go through every frame of the file, the others only care about the latest
+	auto CamSettings = dynamic_cast<const VideoCaptureCameraSettings*>(Cam->GetCameraSettings());
+	if (GetCaptureConfig().ContinuousCapture && CamSettings && CamSettings->StartType != CameraStartType::PLAYBACK)
+	{
+		Cam->StartCaptureThread();
+	}
+	Thread = make_unique<thread>(&CameraWorker::ThreadEntryPoint, this);
+}
+
+CameraWorker::~CameraWorker()
+{
+	killed = true;
+	Jobs.Close();
+	Results.Close();
+	if (Thread)
+	{
+		Thread->join();
+	}
+	Cam->StopCaptureThread();
+}
+
+bool CameraWorker::Request(Job InJob)
+{
+	if (InFlight)
+	{
+		return false;
+	}
+	if (!Jobs.TryPush(InJob))
+	{
+		return false;
+	}
+	InFlight = true;
+	return true;
+}
+
+optional<CameraWorker::Result> CameraWorker::Collect(chrono::milliseconds Timeout)
+{
+	if (!InFlight)
+	{
+		return nullopt;
+	}
+	auto result = Results.Pop(Timeout);
+	if (result.has_value())
+	{
+		InFlight = false;
+	}
+	return result;
+}
+
+void CameraWorker::ThreadEntryPoint()
+{
+	string ThreadName = string("Worker ") + Cam->GetName().substr(0, 8);
+	SetThreadName(ThreadName.c_str());
+	while (!killed)
+	{
+		auto job = Jobs.Pop();
+		if (!job.has_value())
+		{
+			break;
+		}
+		auto cam_settings = Cam->GetCameraSettings();
+		Result result;
+		CameraFeatureData &FeatData = result.FeatureData;
+		auto &Profiler = result.Profiler;
+		LatencyStats* Latency = job->MeasureLatency ? &result.Latency : nullptr;
+		Profiler.EnterSection("CameraRead");
+		if(!Cam->NextFrame())
+		{
+			FeatData.Clear();
+			Profiler.EnterSection("");
+			Results.Push(move(result));
+			continue;
+		}
+		//frames presented again by a replay were not grabbed
+		if (Latency && Cam->GetGrabDuration().count() > 0)
+		{
+			Latency->Add("grab", Cam->GetGrabDuration());
+			Latency->Add("decode", Cam->GetReadDuration());
+		}
+		StageTimer Timer(Latency);
+		const auto &Settings = CDFRCommon::ExternalSettings;
+		bool WantDepth = cam_settings->IsStereo() && Settings.DepthMapping;
+		if (cam_settings->WantUndistortion || WantDepth)
+		{
+			Profiler.EnterSection("CameraUndistort");
+			//between two sweeps, the tracked detection only looks around the tags, so only that needs undistorting
+			bool ROIsOnly = Settings.UndistortROIsOnly && cam_settings->WantUndistortion && !WantDepth
+				&& Settings.ArucoDetection && Settings.SegmentedDetection && Settings.TrackedDetection 
+				&& !Settings.POIDetection && !Settings.YoloDetection
+				&& !Cam->ArucoTracking.SweepDue(cam_settings->Lenses.size(), Settings.FullSweepInterval);
+			vector<Rect> ROIs;
+			if (ROIsOnly)
+			{
+				vector<LensSettings> Lenses;
+				Cam->GetCameraSettingsAfterUndistortion(Lenses);
+				for (size_t lensidx = 0; lensidx < Lenses.size() && lensidx < Cam->ArucoTracking.LastROIs.size(); lensidx++)
+				{
+					for (const Rect &roi : Cam->ArucoTracking.LastROIs[lensidx])
+					{
+						ROIs.push_back(roi + Lenses[lensidx].ROI.tl());
+					}
+				}
+			}
+			if (ROIs.size() > 0)
+			{
+				Cam->Undistort(ROIs);
+			}
+			else
+			{
+				Cam->Undistort();
+			}
+			Timer.Lap("undistort");
+		}
+		Profiler.EnterSection("CameraGetFrame");
+		CameraImageData &ImData = result.ImageData;
+		ImData = Cam->GetFrame(!cam_settings->WantUndistortion);
+		CDFRCommon::ImageToFeatureData(CDFRCommon::ExternalSettings, Cam.get(), ImData, FeatData, *job->Tracker, job->GrabTick, Latency);
+
+		//only queues the new values, the capture side writes them between two frames
+		Cam->SetAutoControlled(Settings.AutoExposure);
+		if (Settings.AutoExposure && Settings.ArucoDetection)
+		{
+			Profiler.EnterSection("AutoExposure");
+			Cam->AutoExposure.Update(*Cam, ImData, FeatData);
+		}
+
+		if (cam_settings->IsStereo() && CDFRCommon::ExternalSettings.DepthMapping)
+		{
+			CameraImageData StereoData = Cam->GetFrame(false);
+			DetectStereo(StereoData, FeatData);
+		}
+
+		if (job->Record)
+		{
+			cout << "\aRecording image " << TimeToStr() << endl;
+			Cam->Record(job->RecordPath, job->RecordIndex);
+		}
+		Profiler.EnterSection("");
+		Results.Push(move(result));
+	}
+}
@@ -0,0 +1,198 @@
+#include "EntryPoints/Regression.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+#include <Misc/math3d.hpp>
+
+using namespace std;
+using namespace cv;
+
+filesystem::path Regression::GetGoldenPath(filesystem::path Scenario)
+{
+	return Scenario.parent_path() / (Scenario.stem().string() + ".golden.json");
+}
+
+bool Regression::HasScenarioMedia(filesystem::path Scenario)
+{
+	ifstream file(Scenario);
+	nlohmann::json decoded;
+	try
+	{
+		file >> decoded;
+	}
+	catch(const std::exception& e)
+	{
+		cerr << "Could not read scenario " << Scenario << " : " << e.what() << endl;
+		return false;
+	}
+	if (!decoded.is_array())
+	{
+		return false;
+	}
+	for (auto &camera : decoded)
+	{
+		if (!camera.contains("video") || !filesystem::exists(Scenario.parent_path() / camera["video"].get<string>()))
+		{
+			return false;
+		}
+	}
+	return decoded.size() > 0;
+}
+
+vector<Regression::ObjectPose> Regression::ToPoses(const vector<ObjectData> &Objects)
+{
+	vector<ObjectPose> poses;
+	poses.reserve(Objects.size());
+	for (auto &object : Objects)
+	{
+		poses.push_back({object.name, object.type, object.location.translation(), GetRotZ(object.location.rotation())});
+	}
+	return poses;
+}
+
+bool Regression::Load(filesystem::path Path, Trajectory &Out)
+{
+	ifstream file(Path);
+	if (!file.is_open())
+	{
+		cerr << "Could not open golden trajectory " << Path << endl;
+		return false;
+	}
+	try
+	{
+		nlohmann::json decoded;
+		file >> decoded;
+		Out.PositionTolerance = decoded.value("PositionTolerance", Out.PositionTolerance);
+		Out.RotationTolerance = decoded.value("RotationTolerance", Out.RotationTolerance);
+		Out.TickBudget = decoded.value("TickBudget", Out.TickBudget);
+		Out.Ticks.clear();
+		for (auto &tick : decoded.at("Ticks"))
+		{
+			auto &poses = Out.Ticks.emplace_back();
+			for (auto &object : tick)
+			{
+				auto position = object.at("Position");
+				poses.push_back({object.at("Name").get<string>(), (ObjectType)object.at("Type").get<int>(), 
+					Vec3d(position.at(0).get<double>(), position.at(1).get<double>(), position.at(2).get<double>()), 
+					object.at("Rotation").get<double>()});
+			}
+		}
+	}
+	catch(const std::exception& e)
+	{
+		cerr << "Could not read golden trajectory " << Path << " : " << e.what() << endl;
+		return false;
+	}
+	return true;
+}
+
+bool Regression::Save(filesystem::path Path, const Trajectory &In)
+{
+	nlohmann::json encoded;
+	encoded["PositionTolerance"] = In.PositionTolerance;
+	encoded["RotationTolerance"] = In.RotationTolerance;
+	encoded["TickBudget"] = In.TickBudget;
+	nlohmann::json &ticks = encoded["Ticks"];
+	ticks = nlohmann::json::array();
+	for (auto &tick : In.Ticks)
+	{
+		nlohmann::json poses = nlohmann::json::array();
+		for (auto &pose : tick)
+		{
+			poses.push_back({
+				{"Name", pose.Name},
+				{"Type", (int)pose.Type},
+				{"Position", {pose.Position[0], pose.Position[1], pose.Position[2]}},
+				{"Rotation", pose.Rotation}
+			});
+		}
+		ticks.push_back(poses);
+	}
+	ofstream file(Path);
+	file << encoded.dump(1, '\t');
+	if (!file.good())
+	{
+		cerr << "Could not write golden trajectory " << Path << endl;
+		return false;
+	}
+	return true;
+}
+
+size_t Regression::Compare(const Trajectory &Golden, const Trajectory &Actual)
+{
+	size_t failures = 0;
+	if (Actual.Ticks.size() < Golden.Ticks.size())
+	{
+		cerr << "Only " << Actual.Ticks.size() << " ticks were run, the golden trajectory has " << Golden.Ticks.size() << endl;
+		failures++;
+	}
+	size_t NumTicks = min(Golden.Ticks.size(), Actual.Ticks.size());
+	for (size_t tick = 0; tick < NumTicks; tick++)
+	{
+		const auto &expected = Golden.Ticks[tick];
+		const auto &actual = Actual.Ticks[tick];
+		//names are not unique (yolo classes...) : match one to one, closest pairs first
+		struct Candidate
+		{
+			size_t Expected, Actual;
+			double Distance;
+		};
+		vector<Candidate> candidates;
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			for (size_t j = 0; j < actual.size(); j++)
+			{
+				if (actual[j].Name == expected[i].Name && actual[j].Type == expected[i].Type)
+				{
+					candidates.push_back({i, j, norm(actual[j].Position - expected[i].Position)});
+				}
+			}
+		}
+		sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b)
+		{
+			return a.Distance < b.Distance;
+		});
+		vector<int> MatchedActual(expected.size(), -1);
+		vector<bool> ActualUsed(actual.size(), false);
+		for (const Candidate &candidate : candidates)
+		{
+			if (MatchedActual[candidate.Expected] >= 0 || ActualUsed[candidate.Actual])
+			{
+				continue;
+			}
+			MatchedActual[candidate.Expected] = candidate.Actual;
+			ActualUsed[candidate.Actual] = true;
+		}
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			if (MatchedActual[i] < 0)
+			{
+				cerr << "Tick " << tick << " : " << expected[i].Name << " is missing" << endl;
+				failures++;
+				continue;
+			}
+			const ObjectPose &found = actual[MatchedActual[i]];
+			double distance = norm(found.Position - expected[i].Position);
+			double rotation = abs(remainder(found.Rotation - expected[i].Rotation, 2*M_PI));
+			if (distance > Golden.PositionTolerance || rotation > Golden.RotationTolerance)
+			{
+				cerr << "Tick " << tick << " : " << expected[i].Name << " is off by " << distance*1000 << "mm and " 
+					<< rotation*180/M_PI << "deg" << endl;
+				failures++;
+			}
+		}
+		for (size_t j = 0; j < actual.size(); j++)
+		{
+			if (!ActualUsed[j])
+			{
+				cerr << "Tick " << tick << " : " << actual[j].Name << " was not expected" << endl;
+				failures++;
+			}
+		}
+	}
+	return failures;
+}
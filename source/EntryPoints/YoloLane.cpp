@@ -0,0 +1,103 @@
+#include "EntryPoints/YoloLane.hpp"
+
+#include <iostream>
+#include <cassert>
+
+#include <DetectFeatures/YoloDetect.hpp>
+#include <Transport/thread-rename.hpp>
+
+using namespace std;
+
+YoloLane::YoloLane(YoloDetect* InDetector)
+	:Detector(InDetector)
+{
+	Thread = make_unique<thread>(&YoloLane::ThreadEntryPoint, this);
+}
+
+YoloLane::~YoloLane()
+{
+	{
+		unique_lock lock(PendingMutex);
+		killed = true;
+	}
+	PendingCondition.notify_all();
+	if (Thread)
+	{
+		Thread->join();
+	}
+}
+
+void YoloLane::Submit(const vector<CameraImageData> &Images, const vector<CameraFeatureData> &Features)
+{
+	assert(Images.size() == Features.size());
+	{
+		unique_lock lock(PendingMutex);
+		for (size_t i = 0; i < Images.size(); i++)
+		{
+			if (!Images[i].Valid)
+			{
+				continue;
+			}
+			auto &slot = Pending[Images[i].CameraName];
+			if (slot.Image.Valid)
+			{
+				Dropped++;
+			}
+			slot.Image = Images[i];
+			slot.Features.Clear();
+			slot.Features.CopyEssentials(Images[i]);
+			slot.Features.WorldToCamera = Features[i].WorldToCamera;
+		}
+	}
+	PendingCondition.notify_one();
+}
+
+shared_ptr<const YoloLane::Result> YoloLane::GetLatest() const
+{
+	return atomic_load(&Latest);
+}
+
+void YoloLane::ThreadEntryPoint()
+{
+	SetThreadName("YoloLane");
+	uint64_t Sequence = 0;
+	while (true)
+	{
+		map<string, PendingFrame> Frames;
+		{
+			unique_lock lock(PendingMutex);
+			PendingCondition.wait(lock, [this](){return killed || Pending.size() > 0;});
+			if (killed)
+			{
+				break;
+			}
+			swap(Frames, Pending);
+		}
+		vector<CameraImageData> Images;
+		vector<CameraFeatureData*> Features;
+		Images.reserve(Frames.size());
+		Features.reserve(Frames.size());
+		for (auto &frame : Frames)
+		{
+			Images.push_back(frame.second.Image);
+			Features.push_back(&frame.second.Features);
+		}
+		Detector->DetectBatch(Images, Features);
+
+		auto result = make_shared<Result>();
+		result->Sequence = ++Sequence;
+		result->GrabTime = Images.size() > 0 ? Images[0].GrabTime : chrono::steady_clock::now();
+		for (size_t i = 0; i < Images.size(); i++)
+		{
+			result->GrabTime = min(result->GrabTime, Images[i].GrabTime);
+			auto &lenses = result->Detections[Images[i].CameraName];
+			for (auto &lens : Features[i]->Lenses)
+			{
+				lenses.push_back(lens.YoloDetections);
+			}
+			auto objects = Detector->Project(Images[i], *Features[i]);
+			result->Objects.insert(result->Objects.end(), objects.begin(), objects.end());
+		}
+		atomic_store(&Latest, shared_ptr<const Result>(move(result)));
+	}
+}
@@ -14,6 +14,7 @@ using namespace cv;
 bool IdleOnStart = true;
 bool ScreenCapture = false;
 string Scenario = "";
+bool ScenarioRealTime = false;
 aruco::ArucoDetector ArucoDet;
 bool HasDetector = false;
 vector<UMat> MarkerImages;
@@ -26,7 +27,7 @@ bool RecordVideo = false;
 KeepAliveSettings KeepAliveConfig = {30, 3*60}; //Delay between messages, Delay before kick when no response
 
 //Default values
-CaptureConfig CaptureCfg = {(int)CameraStartType::ANY, 1.f, 30, 1, "", 0, 100};
+CaptureConfig CaptureCfg = {(int)CameraStartType::ANY, 1.f, 1, 30, 1, "", 0, 100, false, 4, true, false};
 vector<InternalCameraConfig> CamerasInternal;
 CalibrationConfig CamCalConf = {40, Size(6,4), 0.5, 1.5, Size2d(4.96, 3.72)};
 
@@ -73,6 +74,7 @@ void InitConfig()
 	}
 
 	CopyOrDefaultRef(configobj, "Scenario", Scenario);
+	CopyOrDefaultRef(configobj, "ScenarioRealTime", ScenarioRealTime);
 	CopyOrDefaultRef(configobj, "ScreenCapture", ScreenCapture);
 	CopyOrDefaultRef(configobj, "IdleOnStart", IdleOnStart);
 
@@ -82,9 +84,14 @@ void InitConfig()
 		CopyOrDefaultRef(Capture, 		"FramerateDivider", CaptureCfg.FramerateDivider);
 		CopyOrDefaultRef(Capture, 		"Method", 			CaptureCfg.StartType);
 		CopyOrDefaultRef(Capture, 		"Reduction", 		CaptureCfg.ReductionFactor);
+		CopyOrDefaultRef(Capture, 		"DecodeReduction", 	CaptureCfg.DecodeReduction);
 		CopyOrDefaultRef(Capture, 		"CameraFilter", 	CaptureCfg.filter);
 		CopyOrDefaultRef(Capture, 		"Brightness", 		CaptureCfg.Brightness);
 		CopyOrDefaultRef(Capture, 		"Gain", 			CaptureCfg.Gain);
+		CopyOrDefaultRef(Capture, 		"CompactUndistortMaps", CaptureCfg.CompactUndistortMaps);
+		CopyOrDefaultRef(Capture, 		"V4L2Buffers", 		CaptureCfg.V4L2Buffers);
+		CopyOrDefaultRef(Capture, 		"ContinuousCapture", CaptureCfg.ContinuousCapture);
+		CopyOrDefaultRef(Capture, 		"RecordRaw", 		CaptureCfg.RecordRaw);
 	}
 
 	nlohmann::json &CamerasSett = CopyOrDefaultJson(configobj, "InternalCameras");
@@ -148,6 +155,12 @@ string GetScenario()
 	return Scenario;
 }
 
+bool GetScenarioRealTime()
+{
+	InitConfig();
+	return ScenarioRealTime;
+}
+
 
 bool GetIdleOnStart()
 {
@@ -204,6 +217,25 @@ float GetReductionFactor()
 	return CaptureCfg.ReductionFactor;
 }
 
+void SetReductionFactor(float Factor)
+{
+	InitConfig();
+	CaptureCfg.ReductionFactor = Factor;
+}
+
+int GetDecodeReduction()
+{
+	InitConfig();
+	for (int reduction : {8, 4, 2})
+	{
+		if (CaptureCfg.DecodeReduction >= reduction)
+		{
+			return reduction;
+		}
+	}
+	return 1;
+}
+
 int& GetBrightness()
 {
 	InitConfig();
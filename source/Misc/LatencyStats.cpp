@@ -0,0 +1,58 @@
+#include "Misc/LatencyStats.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+static double GetSortedPercentile(const vector<double> &Sorted, double Percentile)
+{
+	if (Sorted.empty())
+	{
+		return 0;
+	}
+	size_t rank = (size_t)ceil(Percentile / 100.0 * Sorted.size());
+	rank = clamp<size_t>(rank, 1, Sorted.size());
+	return Sorted[rank-1];
+}
+
+void LatencyStats::operator+=(const LatencyStats &other)
+{
+	for (auto &[stage, samples] : other.Samples)
+	{
+		auto &ours = Samples[stage];
+		ours.insert(ours.end(), samples.begin(), samples.end());
+	}
+}
+
+double LatencyStats::GetPercentile(const string &Stage, double Percentile) const
+{
+	auto found = Samples.find(Stage);
+	if (found == Samples.end())
+	{
+		return 0;
+	}
+	vector<double> sorted = found->second;
+	sort(sorted.begin(), sorted.end());
+	return GetSortedPercentile(sorted, Percentile);
+}
+
+nlohmann::json LatencyStats::ToJson() const
+{
+	nlohmann::json stages = nlohmann::json::object();
+	for (auto &[stage, samples] : Samples)
+	{
+		vector<double> sorted = samples;
+		sort(sorted.begin(), sorted.end());
+		double sum = accumulate(sorted.begin(), sorted.end(), 0.0);
+		nlohmann::json &out = stages[stage];
+		out["count"] = sorted.size();
+		out["mean_ms"] = sorted.empty() ? 0 : sum / sorted.size() * 1e3;
+		out["p50_ms"] = GetSortedPercentile(sorted, 50) * 1e3;
+		out["p95_ms"] = GetSortedPercentile(sorted, 95) * 1e3;
+		out["p99_ms"] = GetSortedPercentile(sorted, 99) * 1e3;
+		out["max_ms"] = sorted.empty() ? 0 : sorted.back() * 1e3;
+	}
+	return stages;
+}
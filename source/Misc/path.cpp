@@ -18,6 +18,15 @@ filesystem::path GetScreenCapturePath()
     return GetCyclopsPath()/"ScreenCapture";
 }
 
+filesystem::path GetScenarioPath(filesystem::path Scenario)
+{
+    if (filesystem::exists(Scenario))
+    {
+        return Scenario;
+    }
+    return GetCyclopsPath()/"sim"/Scenario;
+}
+
 void SetExecutablePath(const char* path)
 {
     ExecutablePath = filesystem::weakly_canonical(filesystem::path(path));
@@ -30,7 +30,7 @@ void ExternalBoardGL::ThreadEntryPoint()
 	}
 	if (!killed && !Parent->IsKilled())
 	{
-		closed = !Tick(ObjectData::ToGLObjects(Parent->GetObjectData()));
+		closed = !Tick(ObjectData::ToGLObjects(Parent->GetSnapshot()->ObjData));
 		killed |= closed;		
 	}
 	else
@@ -7,6 +7,7 @@
 #include <Misc/math2d.hpp>
 #include <EntryPoints/CDFRExternal.hpp>
 #include <EntryPoints/CDFRCommon.hpp>
+#include <Cameras/FramePool.hpp>
 #include <Visualisation/external/ExternalBoardGL.hpp>
 
 using namespace std;
@@ -38,15 +39,16 @@ bool ExternalImgui::DisplayFrame(CDFRExternal *Parent)
 	StartFrame();
 	//cout << "new frame" <<endl;
 	int DisplaysPerCam = 1;
-	auto Cameras = Parent->GetImage();
-	Cameras.erase(
-		remove_if(
-			Cameras.begin(), 
-			Cameras.end(), 
-			[](CameraImageData& cam){return !cam.Valid;}
-		),
-		Cameras.end());
-	auto Features = Parent->GetFeatureData();
+	auto Snapshot = Parent->GetSnapshot();
+	//Indices of the cameras with a valid image, the snapshot is shared so it is filtered by index instead of being modified
+	vector<size_t> Cameras;
+	for (size_t i = 0; i < Snapshot->ImageData.size(); i++)
+	{
+		if (Snapshot->ImageData[i].Valid)
+		{
+			Cameras.push_back(i);
+		}
+	}
 	int NumDisplays = Cameras.size()*DisplaysPerCam;
 	if ((int)Textures.size() != NumDisplays)
 	{
@@ -57,12 +59,20 @@ bool ExternalImgui::DisplayFrame(CDFRExternal *Parent)
 	cv::Size ImageSize = WindowSize;
 	if (Cameras.size() > 0)
 	{
-		ImageSize = Cameras[0].Image.size();
+		ImageSize = Snapshot->ImageData[Cameras[0]].Image.size();
 	}
 
 	if (ImGui::Begin("Settings"))
 	{
 		ImGui::Text("%.1f fps", 1.0/Parent->DetectionFrameCounter.GetLastDelta());
+		if (Snapshot->Sequence != LastAllocationSequence)
+		{
+			uint64_t Allocations = FramePool::GetTotalAllocations();
+			AllocationsPerFrame = (double)(Allocations - LastAllocationCount) / (Snapshot->Sequence - LastAllocationSequence);
+			LastAllocationCount = Allocations;
+			LastAllocationSequence = Snapshot->Sequence;
+		}
+		ImGui::Text("%.2f frame allocations per tick", AllocationsPerFrame);
 		if (!Parent->OpenGLBoard)
 		{
 			if (ImGui::Button("Open 3D vizualiser"))
@@ -102,11 +112,17 @@ bool ExternalImgui::DisplayFrame(CDFRExternal *Parent)
 			//ImGui::Checkbox("Freeze camera position", nullptr);
 			ImGui::Checkbox("Aruco Detection", &entry.second.ArucoDetection);
 			ImGui::Checkbox("Distorted detection", &entry.second.DistortedDetection);
+			ImGui::Checkbox("Undistort tracked ROIs only", &entry.second.UndistortROIsOnly);
 			ImGui::Checkbox("Segmented detection", &entry.second.SegmentedDetection);
+			ImGui::Checkbox("Tracked detection", &entry.second.TrackedDetection);
+			ImGui::InputInt("Full sweep interval", &entry.second.FullSweepInterval);
+			ImGui::Checkbox("Tune segment grid", &entry.second.TuneSegments);
 			ImGui::Checkbox("POI Detection", &entry.second.POIDetection);
 			ImGui::Checkbox("Yolo detection", &entry.second.YoloDetection);
 			ImGui::Checkbox("Depth mapping", &entry.second.DepthMapping);
 			ImGui::Checkbox("Denoising", &entry.second.Denoising);
+			ImGui::Checkbox("Auto exposure from tags", &entry.second.AutoExposure);
+			ImGui::Checkbox("Log features", &entry.second.LogFeatures);
 			ImGui::Spacing();
 		}
 		
@@ -133,10 +149,10 @@ bool ExternalImgui::DisplayFrame(CDFRExternal *Parent)
 	for (size_t camidx = 0; camidx < Cameras.size(); camidx++)
 	{
 		auto &thisTile = tiles[camidx*DisplaysPerCam];
-		const auto &ImData = Cameras[camidx];
-		const auto &FeatData = Features[camidx];
+		const auto &ImData = Snapshot->ImageData[Cameras[camidx]];
+		const auto &FeatData = Snapshot->FeatureData[Cameras[camidx]];
 		Size Resolution = ImData.Image.size();
-		if (LastMatrices[camidx*DisplaysPerCam] != ImData.Image.u)
+		if (LastMatrices[camidx*DisplaysPerCam] != ImData.Image.u || LastTexturesSequence != Snapshot->Sequence)
 		{
 			//cout << "Updating " << Textures[camidx*DisplaysPerCam].GetTextureID() << " to " << ImData.Image.u << endl;
 			LastMatrices[camidx*DisplaysPerCam] = ImData.Image.u;
@@ -235,8 +251,9 @@ bool ExternalImgui::DisplayFrame(CDFRExternal *Parent)
 					uint32_t color = IM_COL32(r,g,b,det.Confidence*255);
 					
 					Point2d textpos(0,0);
-					auto tl = ImageRemap<double>(SourceRemap, DestRemap, det.Corners.tl());
-					auto br = ImageRemap<double>(SourceRemap, DestRemap, det.Corners.br());
+					Point2f LensOffset = FeatData.Lenses[lensidx].ROI.tl();
+					auto tl = ImageRemap<double>(SourceRemap, DestRemap, det.Corners.tl() + LensOffset);
+					auto br = ImageRemap<double>(SourceRemap, DestRemap, det.Corners.br() + LensOffset);
 					DrawList->AddRect(tl, br, color);
 					//text with class and confidence
 					string text = Parent->YoloDetector->GetClassName(det.Class) + string("\n") + to_string(int(det.Confidence*100));
@@ -246,6 +263,7 @@ bool ExternalImgui::DisplayFrame(CDFRExternal *Parent)
 		}
 		
 	}
+	LastTexturesSequence = Snapshot->Sequence;
 	if(!EndFrame())
 	{
 		killed = true;
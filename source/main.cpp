@@ -24,6 +24,7 @@
 #include <EntryPoints/CDFRInternal.hpp>
 #include <EntryPoints/CDFRCommon.hpp>
 #include <EntryPoints/Mapping.hpp>
+#include <EntryPoints/Regression.hpp>
 
 #include <Communication/AdvertiseMV.hpp>
 #include <Communication/TCPJsonHost.hpp>
@@ -117,6 +118,14 @@ int main(int argc, char** argv )
 		"{calibrate c  |  | start camera calibration wizard}"
 		"{marker m     |  | print out markers}"
 		"{map          |  | runs object mapping, using saved images and calibration}"
+		"{log l        |  | log the features and objects of every tick, for replay}"
+		"{replay       |  | replay a feature log through the trackers instead of running the cameras}"
+		"{bench        |  | run a simulation scenario headless and report the latency of each stage as json}"
+		"{ticks        | 1000 | number of ticks measured by bench}"
+		"{benchout     |  | file the bench report is written to, stdout if empty}"
+		"{regress      |  | replay a scenario and compare the objects to its golden trajectory, fails on drift or over budget}"
+		"{golden       |  | with regress, record the golden trajectory instead of comparing}"
+		"{budget       | 0 | with regress, tick time p95 budget in ms, overrides the golden one}"
 		;
 	CommandLineParser parser(argc, argv, keys);
 
@@ -183,6 +192,7 @@ int main(int argc, char** argv )
 	CDFRCommon::ExternalSettings.direct = parser.has("direct") ? parser.get<bool>("direct") : true;
 	CDFRCommon::ExternalSettings.v3d = parser.has("opengl") ? parser.get<bool>("opengl") : false;
 	CDFRCommon::ExternalSettings.record = parser.has("record");
+	CDFRCommon::ExternalSettings.LogFeatures = parser.has("log");
 	
 	if (parser.has("map"))
 	{
@@ -190,6 +200,58 @@ int main(int argc, char** argv )
 		return EXIT_SUCCESS;
 	}
 	
+	if (parser.has("bench"))
+	{
+		ExternalBenchmark Bench;
+		Bench.Scenario = parser.get<string>("bench");
+		Bench.Ticks = parser.get<int>("ticks");
+		Bench.Output = parser.get<string>("benchout");
+		CDFRExternal ExternalCameraHost(filesystem::path(), Bench);
+		while (!ExternalCameraHost.IsKilled() && !killrequest)
+		{
+			this_thread::sleep_for(chrono::milliseconds(10));
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if (parser.has("regress"))
+	{
+		ExternalBenchmark Bench;
+		Bench.Scenario = GetScenarioPath(parser.get<string>("regress"));
+		Bench.Golden = Regression::GetGoldenPath(Bench.Scenario);
+		Bench.RecordGolden = parser.has("golden");
+		Bench.TickBudget = parser.get<double>("budget");
+		Bench.Ticks = parser.get<int>("ticks");
+		Bench.Output = parser.get<string>("benchout");
+		if (!Regression::HasScenarioMedia(Bench.Scenario))
+		{
+			//ctest SKIP_RETURN_CODE : the recordings are not in the repository
+			cout << "Recordings of " << Bench.Scenario << " are missing, skipping" << endl;
+			return 77;
+		}
+		if (!Bench.RecordGolden && !filesystem::exists(Bench.Golden))
+		{
+			cerr << "No golden trajectory at " << Bench.Golden << ", record one with --golden" << endl;
+			return EXIT_FAILURE;
+		}
+		CDFRExternal ExternalCameraHost(filesystem::path(), Bench);
+		while (!ExternalCameraHost.IsKilled() && !killrequest)
+		{
+			this_thread::sleep_for(chrono::milliseconds(10));
+		}
+		return ExternalCameraHost.HasBenchmarkFailed() || killrequest ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	if (parser.has("replay"))
+	{
+		CDFRExternal ExternalCameraHost(parser.get<string>("replay"));
+		while (!ExternalCameraHost.IsKilled() && !killrequest)
+		{
+			this_thread::sleep_for(chrono::milliseconds(10));
+		}
+		return EXIT_SUCCESS;
+	}
+	
 	{
 		//AdvertiseMV advertiser;
 		TCPJsonHost JsonHost(50667);
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <functional>
+#include <filesystem>
+#include <opencv2/core.hpp>
+
+#include <EntryPoints/Regression.hpp>
+
+using namespace std;
+using namespace cv;
+
+//Checks the golden trajectory comparison used by the scenario regression tests, on a small hand written trajectory
+//Usage : cyclops_regression_test <sample.golden.json>
+
+int NumFailed = 0;
+
+void Check(const string &Name, bool Passed)
+{
+	cout << (Passed ? "[ OK ] " : "[FAIL] ") << Name << endl;
+	NumFailed += Passed ? 0 : 1;
+}
+
+//Copy of the golden, changed by Modifier, then compared to it
+size_t CompareModified(const Regression::Trajectory &Golden, function<void(Regression::Trajectory&)> Modifier)
+{
+	Regression::Trajectory actual = Golden;
+	Modifier(actual);
+	return Regression::Compare(Golden, actual);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		cerr << "Usage : " << argv[0] << " <sample.golden.json>" << endl;
+		return EXIT_FAILURE;
+	}
+	Regression::Trajectory golden;
+	Check("load", Regression::Load(argv[1], golden));
+	Check("loaded tolerances", golden.PositionTolerance == 0.01 && golden.RotationTolerance == 0.1 && golden.TickBudget == 40);
+	Check("loaded ticks", golden.Ticks.size() == 2 && golden.Ticks[0].size() == 3 && golden.Ticks[1].size() == 2);
+	if (NumFailed > 0)
+	{
+		return EXIT_FAILURE;
+	}
+	Check("identical", Regression::Compare(golden, golden) == 0);
+
+	auto saved = filesystem::temp_directory_path() / "cyclops_regression_test.golden.json";
+	Regression::Trajectory reloaded;
+	Check("save", Regression::Save(saved, golden));
+	Check("reload", Regression::Load(saved, reloaded));
+	Check("roundtrip", reloaded.Ticks.size() == golden.Ticks.size() && reloaded.TickBudget == golden.TickBudget 
+		&& Regression::Compare(golden, reloaded) == 0);
+	filesystem::remove(saved);
+
+	Check("within tolerance", CompareModified(golden, [](auto &t){t.Ticks[0][0].Position[0] += 0.005;}) == 0);
+	Check("rotation wraps around", CompareModified(golden, [](auto &t){t.Ticks[1][0].Rotation = 3.1;}) == 0);
+	Check("moved", CompareModified(golden, [](auto &t){t.Ticks[0][0].Position[1] += 0.05;}) == 1);
+	Check("rotated", CompareModified(golden, [](auto &t){t.Ticks[0][2].Rotation += 0.5;}) == 1);
+	Check("same name in another order", CompareModified(golden, [](auto &t){swap(t.Ticks[0][1], t.Ticks[0][2]);}) == 0);
+	//both fragiles at the same place : one is where it should be, the other is missing its match
+	Check("same name matched once", CompareModified(golden, [](auto &t){t.Ticks[0][2] = t.Ticks[0][1];}) == 1);
+	Check("missing", CompareModified(golden, [](auto &t){t.Ticks[0].pop_back();}) == 1);
+	Check("not expected", CompareModified(golden, [](auto &t){t.Ticks[1].push_back(t.Ticks[0][2]);}) == 1);
+	Check("other type", CompareModified(golden, [](auto &t){t.Ticks[1][1].Type = ObjectType::Pot2024;}) == 2);
+	Check("too few ticks", CompareModified(golden, [](auto &t){t.Ticks.pop_back();}) == 1);
+
+	cout << NumFailed << " checks failed" << endl;
+	return NumFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <cmath>
+#include <opencv2/core.hpp>
+
+#include <DetectFeatures/YoloDetect.hpp>
+
+using namespace std;
+using namespace cv;
+
+//Checks how YOLO network outputs are decoded into detections, on small synthetic output blobs
+//Usage : cyclops_yolo_test
+
+int NumFailed = 0;
+
+void Check(const string &Name, bool Passed)
+{
+	cout << (Passed ? "[ OK ] " : "[FAIL] ") << Name << endl;
+	NumFailed += Passed ? 0 : 1;
+}
+
+bool Near(double a, double b)
+{
+	return abs(a-b) < 1e-3;
+}
+
+const int numclasses = 4;
+const Size inpSize(640, 480);
+
+//x, y, width, height, objectness, then one score per class
+void SetRow(float* row, int stride, Vec4f Box, float Objectness, int Class, float Score)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		row[i*stride] = Box[i];
+	}
+	row[4*stride] = Objectness;
+	row[(5+Class)*stride] = Score;
+}
+
+int main(int argc, char** argv)
+{
+	(void)argc; (void)argv;
+	vector<YoloDetect::Letterbox> letterboxes(2, {1.0, Point2d(0,0)});
+
+	//Darknet : [batch*N, 5+classes], boxes relative to the input, class scores already multiplied by the objectness
+	Mat darknet(4, 5+numclasses, CV_32F, Scalar(0));
+	SetRow(darknet.ptr<float>(0), 1, Vec4f(0.5, 0.5, 0.1, 0.1), 0.6, 1, 0.54);
+	SetRow(darknet.ptr<float>(1), 1, Vec4f(0.2, 0.2, 0.1, 0.1), 0.3, 0, 0.3);
+	SetRow(darknet.ptr<float>(2), 1, Vec4f(0.25, 0.75, 0.2, 0.1), 0.9, 2, 0.8);
+	auto detections = YoloDetect::Postprocess({darknet}, letterboxes, inpSize, numclasses, true);
+	Check("darknet images", detections.size() == 2);
+	if (NumFailed > 0)
+	{
+		return EXIT_FAILURE;
+	}
+	Check("darknet objectness applied once", detections[0].size() == 1
+		&& detections[0][0].Class == 1 && Near(detections[0][0].Confidence, 0.54));
+	if (detections[0].size() == 1)
+	{
+		Rect2f box = detections[0][0].BoundingBox;
+		Check("darknet box scaled to input", Near(box.x, 288) && Near(box.y, 216) && Near(box.width, 64) && Near(box.height, 48));
+	}
+	Check("darknet second image", detections[1].size() == 1
+		&& detections[1][0].Class == 2 && Near(detections[1][0].Confidence, 0.8));
+
+	//YOLOv5 : [batch, N, 5+classes], boxes in input pixels, class scores are multiplied by the objectness
+	int v5sizes[] = {1, 2, 5+numclasses};
+	Mat yolov5(3, v5sizes, CV_32F, Scalar(0));
+	float* v5data = yolov5.ptr<float>(0);
+	SetRow(v5data, 1, Vec4f(100, 100, 20, 20), 0.5, 0, 0.7);
+	SetRow(v5data + 5+numclasses, 1, Vec4f(300, 200, 40, 20), 0.9, 3, 0.9);
+	detections = YoloDetect::Postprocess({yolov5}, {letterboxes[0]}, inpSize, numclasses, false);
+	Check("yolov5 objectness applied", detections.size() == 1 && detections[0].size() == 1
+		&& detections[0][0].Class == 3 && Near(detections[0][0].Confidence, 0.81));
+
+	//YOLOv8 : [batch, 4+classes, N], no objectness
+	int v8sizes[] = {1, 4+numclasses, 2};
+	Mat yolov8(3, v8sizes, CV_32F, Scalar(0));
+	float* v8data = yolov8.ptr<float>(0);
+	for (int i = 0; i < 4; i++)
+	{
+		v8data[i*2] = Vec4f(100, 100, 20, 20)[i];
+		v8data[i*2+1] = Vec4f(300, 200, 40, 20)[i];
+	}
+	v8data[(4+1)*2] = 0.3;
+	v8data[(4+2)*2+1] = 0.6;
+	detections = YoloDetect::Postprocess({yolov8}, {letterboxes[0]}, inpSize, numclasses, false);
+	Check("yolov8 class score alone", detections.size() == 1 && detections[0].size() == 1
+		&& detections[0][0].Class == 2 && Near(detections[0][0].Confidence, 0.6));
+
+	//The letterbox is undone : input = lens * Scale + Offset
+	detections = YoloDetect::Postprocess({darknet}, {{0.5, Point2d(0, 40)}, {0.5, Point2d(0, 40)}}, inpSize, numclasses, true);
+	if (detections.size() == 2 && detections[0].size() == 1)
+	{
+		Rect2f box = detections[0][0].BoundingBox;
+		Check("letterbox undone", Near(box.x, 576) && Near(box.y, 352) && Near(box.width, 128) && Near(box.height, 96));
+	}
+	else
+	{
+		Check("letterbox undone", false);
+	}
+
+	cout << NumFailed << " checks failed" << endl;
+	return NumFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}